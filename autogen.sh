@@ -20,4 +20,5 @@ Run mkdir -p -m 755 config
 Run libtoolize
 Run aclocal -I m4 -I martinm4
 Run autoconf
+Run autoheader
 Run automake -a --copy ${1+"$@"}
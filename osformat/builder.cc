@@ -0,0 +1,359 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/builder.h"
+
+#include "osformat/crc32c.h"
+
+#include <stdint.h>  // uint64_t
+
+#include <cerrno>  // errno, EINTR
+#include <climits>  // IOV_MAX
+#include <cstdio>  // fwrite, FILE
+#include <cstring>  // memcpy, memset
+
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>  // sendfile
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>  // writev, iovec
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>  // write, pread, copy_file_range
+#endif
+
+#include <ostream>
+#include <stdexcept>  // std::out_of_range
+#include <string>
+#include <vector>
+
+using std::string;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace osformat {
+
+// The size of the blocks in which file ranges are read if necessary
+static const Builder::size_type kReadBlock = 64 * 1024;
+
+// Declarations of some static helper functions:
+
+// Write all n bytes of data; return false on error
+static bool WriteAll(int fd, const char *data, Builder::size_type n);
+
+// Copy length bytes of the file in starting at offset to out;
+// return false on error
+static bool CopyRange(int out, int in, uint64_t offset,
+  Builder::size_type length);
+
+
+// Definitions of some static helper functions:
+
+static bool WriteAll(int fd, const char *data, Builder::size_type n) {
+#ifdef HAVE_UNISTD_H
+  while (n != 0) {
+    ssize_t written(write(fd, data, n));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    n -= static_cast<Builder::size_type>(written);
+  }
+  return true;
+#else  // !defined(HAVE_UNISTD_H)
+  return (n == 0);
+#endif  // HAVE_UNISTD_H
+}
+
+static bool CopyRange(int out, int in, uint64_t offset,
+    Builder::size_type length) {
+  // Each method stops at its first failure; then the next is tried
+#ifdef HAVE_COPY_FILE_RANGE
+  for (off_t pos(static_cast<off_t>(offset)); length != 0;
+    offset = static_cast<uint64_t>(pos)) {
+    ssize_t copied(copy_file_range(in, &pos, out, NULL, length, 0));
+    if (copied <= 0) {
+      if ((copied < 0) && (errno == EINTR)) {
+        continue;
+      }
+      break;
+    }
+    length -= static_cast<Builder::size_type>(copied);
+  }
+#endif  // HAVE_COPY_FILE_RANGE
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+  for (off_t pos(static_cast<off_t>(offset)); length != 0;
+    offset = static_cast<uint64_t>(pos)) {
+    ssize_t copied(sendfile(out, in, &pos, length));
+    if (copied <= 0) {
+      if ((copied < 0) && (errno == EINTR)) {
+        continue;
+      }
+      break;
+    }
+    length -= static_cast<Builder::size_type>(copied);
+  }
+#endif  // HAVE_SENDFILE && HAVE_SYS_SENDFILE_H
+  string buffer;
+  while (length != 0) {
+    Builder::size_type block((length < kReadBlock) ? length : kReadBlock);
+    buffer.clear();
+    if (!Builder::ReadFile(in, offset, block, &buffer) ||
+      !WriteAll(out, buffer.data(), block)) {
+      return false;
+    }
+    offset += block;
+    length -= block;
+  }
+  return true;
+}
+
+const Builder::size_type Builder::kDefaultChunkSize;
+
+bool Builder::ReadFile(int fd, uint64_t offset, size_type length,
+    string *append) {
+#if defined(HAVE_PREAD) && defined(HAVE_UNISTD_H)
+  size_type start(append->size());
+  append->resize(start + length);
+  size_type done(0);
+  while (done != length) {
+    ssize_t got(pread(fd, &((*append)[start + done]), length - done,
+      static_cast<off_t>(offset + done)));
+    if (got <= 0) {
+      if ((got < 0) && (errno == EINTR)) {
+        continue;
+      }
+      append->resize(start + done);
+      return false;
+    }
+    done += static_cast<size_type>(got);
+  }
+  return true;
+#else  // !defined(HAVE_PREAD) || !defined(HAVE_UNISTD_H)
+  static_cast<void>(fd);
+  static_cast<void>(offset);
+  static_cast<void>(append);
+  return (length == 0);
+#endif  // HAVE_PREAD && HAVE_UNISTD_H
+}
+
+bool Builder::AppendFile(int fd, uint64_t offset, size_type length) {
+  if (length == 0) {
+    return true;
+  }
+  if (checksum_ != NULL) {
+    string contents;
+    bool success(ReadFile(fd, offset, length, &contents));
+    append(contents);
+    return success;
+  }
+  chunks_.push_back(Chunk(fd, offset, length));
+  size_ += length;
+  return true;
+}
+
+Builder::Chunk& Builder::Writable(size_type minimal) {
+  if (!chunks_.empty()) {
+    Chunk& last = chunks_.back();
+    if ((last.data_ != NULL) && (last.used_ != last.capacity_)) {
+      return last;
+    }
+  }
+  size_type capacity((minimal > chunk_size_) ? minimal : chunk_size_);
+  char *data(new char[capacity]);
+  try {
+    chunks_.push_back(Chunk(data, capacity));
+  } catch (...) {
+    delete[] data;
+    throw;
+  }
+  return chunks_.back();
+}
+
+void Builder::append(const char *s, size_type n) {
+  while (n != 0) {
+    Chunk& chunk = Writable(n);
+    size_type len(chunk.capacity_ - chunk.used_);
+    if (len > n) {
+      len = n;
+    }
+    char *dest(chunk.data_ + chunk.used_);
+    std::memcpy(dest, s, len);
+    if (checksum_ != NULL) {
+      checksum_->Update(dest, len);
+    }
+    chunk.used_ += len;
+    size_ += len;
+    s += len;
+    n -= len;
+  }
+}
+
+void Builder::append(const string& s, size_type pos, size_type n) {
+  if (pos > s.size()) {
+    throw std::out_of_range("osformat::Builder::append");
+  }
+  size_type len(s.size() - pos);
+  append(s.data() + pos, (n < len) ? n : len);
+}
+
+void Builder::append(size_type n, char c) {
+  while (n != 0) {
+    Chunk& chunk = Writable(n);
+    size_type len(chunk.capacity_ - chunk.used_);
+    if (len > n) {
+      len = n;
+    }
+    char *dest(chunk.data_ + chunk.used_);
+    std::memset(dest, c, len);
+    if (checksum_ != NULL) {
+      checksum_->Update(dest, len);
+    }
+    chunk.used_ += len;
+    size_ += len;
+    n -= len;
+  }
+}
+
+void Builder::clear() {
+  for (ChunkList::iterator it(chunks_.begin()); it != chunks_.end(); ++it) {
+    delete[] it->data_;
+  }
+  chunks_.clear();
+  size_ = 0;
+}
+
+bool Builder::Output(string *append) const {
+  append->reserve(append->size() + size_);
+  bool success(true);
+  for (ChunkList::const_iterator it(chunks_.begin());
+    it != chunks_.end(); ++it) {
+    if (it->data_ != NULL) {
+      append->append(it->data_, it->used_);
+    } else if (!ReadFile(it->fd_, it->offset_, it->used_, append)) {
+      success = false;
+    }
+  }
+  return success;
+}
+
+bool Builder::Output(FILE *file) const {
+  string contents;
+  for (ChunkList::const_iterator it(chunks_.begin());
+    it != chunks_.end(); ++it) {
+    const char *data(it->data_);
+    if (data == NULL) {
+      contents.clear();
+      if (!ReadFile(it->fd_, it->offset_, it->used_, &contents)) {
+        return false;
+      }
+      data = contents.data();
+    }
+    if (std::fwrite(data, sizeof(char), it->used_, file) < it->used_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Builder::Output(int fd) const {
+  size_type first(0);
+  while (first != chunks_.size()) {
+    size_type last(first);
+    while ((last != chunks_.size()) && (chunks_[last].data_ != NULL)) {
+      ++last;
+    }
+    if (!OutputChunks(fd, first, last)) {
+      return false;
+    }
+    if (last == chunks_.size()) {
+      break;
+    }
+    const Chunk& range = chunks_[last];
+    if (!CopyRange(fd, range.fd_, range.offset_, range.used_)) {
+      return false;
+    }
+    first = last + 1;
+  }
+  return true;
+}
+
+#if defined(HAVE_WRITEV) && defined(HAVE_SYS_UIO_H)
+
+bool Builder::OutputChunks(int fd, size_type first, size_type last) const {
+  std::vector<struct iovec> iov(last - first);
+  for (ChunkList::size_type i(0); i != iov.size(); ++i) {
+    iov[i].iov_base = chunks_[first + i].data_;
+    iov[i].iov_len = chunks_[first + i].used_;
+  }
+  std::vector<struct iovec>::size_type next(0);
+  while (next != iov.size()) {
+    std::vector<struct iovec>::size_type count(iov.size() - next);
+    if (count > IOV_MAX) {
+      count = IOV_MAX;
+    }
+    ssize_t written(writev(fd, &(iov[next]), static_cast<int>(count)));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    // Skip what was written; a partial write continues within an iovec
+    size_type done(static_cast<size_type>(written));
+    while ((next != iov.size()) && (done >= iov[next].iov_len)) {
+      done -= iov[next++].iov_len;
+    }
+    if (done != 0) {
+      iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + done;
+      iov[next].iov_len -= done;
+    }
+  }
+  return true;
+}
+
+#else  // !defined(HAVE_WRITEV) || !defined(HAVE_SYS_UIO_H)
+
+bool Builder::OutputChunks(int fd, size_type first, size_type last) const {
+  for (; first != last; ++first) {
+    if (!WriteAll(fd, chunks_[first].data_, chunks_[first].used_)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif  // HAVE_WRITEV && HAVE_SYS_UIO_H
+
+std::ostream& operator<<(std::ostream& os, const Builder& b) {
+  string contents;
+  for (Builder::ChunkList::const_iterator it(b.chunks_.begin());
+    it != b.chunks_.end(); ++it) {
+    const char *data(it->data_);
+    if (data == NULL) {
+      contents.clear();
+      if (!Builder::ReadFile(it->fd_, it->offset_, it->used_, &contents)) {
+        os.setstate(std::ios_base::failbit);
+        return os;
+      }
+      data = contents.data();
+    }
+    os.write(data, static_cast<std::streamsize>(it->used_));
+  }
+  return os;
+}
+
+}  // namespace osformat
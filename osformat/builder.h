@@ -0,0 +1,178 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_BUILDER_H_
+#define OSFORMAT_BUILDER_H_ 1
+
+#include <stdint.h>  // uint64_t
+
+#include <cstdio>  // size_t, FILE
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace osformat {
+
+class Crc32c;
+
+// A Builder collects a (possibly huge) document in a chain of chunks.
+// In contrast to appending to a std::string, previously written bytes are
+// never moved: If the last chunk is full, a new one is allocated.
+// An osformat::Format which has a Builder as its output renders directly
+// into the chunks; at the end the whole document can be emitted with a
+// single writev() or flattened once into a string.
+// A range of a file can be appended by reference: When the document is
+// written to a file descriptor, its bytes are copied by the kernel
+// (copy_file_range() or sendfile() if possible), never entering user space.
+// Optionally, a checksum is computed while the bytes are copied.
+
+class Builder {
+ public:
+  typedef std::string::size_type size_type;
+
+#if __cplusplus >= 201103L
+  constexpr
+#endif
+  static const size_type kDefaultChunkSize = 64 * 1024;
+
+  explicit Builder(size_type chunk_size = kDefaultChunkSize)
+    : chunk_size_((chunk_size == 0) ? kDefaultChunkSize : chunk_size),
+      size_(0), checksum_(NULL) {
+  }
+
+  ~Builder() {
+    clear();
+  }
+
+  void append(const char *s, size_type n);
+
+  void append(const char *s) {
+    append(s, std::char_traits<char>::length(s));
+  }
+
+  void append(const std::string& s) {
+    append(s.data(), s.size());
+  }
+
+  // Append the substring of s starting at pos with length n (or less).
+  // As for std::string, std::out_of_range is thrown if pos > s.size().
+  void append(const std::string& s, size_type pos, size_type n);
+
+  void append(size_type n, char c);
+
+  void push_back(char c) {
+    append(1, c);
+  }
+
+  // Append length bytes of the file fd, starting at offset. The file is only
+  // read when the document is output, so fd must remain open until then.
+  // If a checksum is set, the bytes are read and appended immediately;
+  // return false if this fails.
+  bool AppendFile(int fd, uint64_t offset, size_type length);
+
+  // Append length bytes of the file fd, starting at offset, to the string;
+  // return false if not all bytes could be read
+  static bool ReadFile(int fd, uint64_t offset, size_type length,
+    std::string *append);
+
+  // All further appended data also updates checksum (if not NULL)
+  void set_checksum(Crc32c *checksum) {
+    checksum_ = checksum;
+  }
+
+  Crc32c *checksum() const {
+    return checksum_;
+  }
+
+  size_type size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return (size_ == 0);
+  }
+
+  // The number of chunks currently in use
+  size_type chunks() const {
+    return chunks_.size();
+  }
+
+  // Free all chunks
+  void clear();
+
+  // Append the whole document to the string (reserving memory only once).
+  // Return false if a file range could not be read completely.
+  bool Output(std::string *append) const;
+
+  // Write the whole document to the FILE; return true if no error
+  bool Output(FILE *file) const;
+
+  // Write the whole document to the file descriptor with writev()
+  // (if available; otherwise with write()) and copy the file ranges
+  // in the kernel (if possible); return true if no error
+  bool Output(int fd) const;
+
+  // A file range which cannot be read is silently left incomplete
+  std::string str() const {
+    std::string result;
+    Output(&result);
+    return result;
+  }
+
+  // As str(), but success tells whether all file ranges could be read
+  std::string str(bool *success) const {
+    std::string result;
+    *success = Output(&result);
+    return result;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const Builder& b);
+
+ private:
+  // A chunk of memory, or (if data_ is NULL) a range of used_ bytes of the
+  // file fd_ starting at offset_
+  class Chunk {
+   public:
+    char *data_;
+    size_type used_;
+    size_type capacity_;
+    int fd_;
+    uint64_t offset_;
+    Chunk(char *data, size_type capacity)
+      : data_(data), used_(0), capacity_(capacity), fd_(-1), offset_(0) {
+    }
+    Chunk(int fd, uint64_t offset, size_type length)
+      : data_(NULL), used_(length), capacity_(0), fd_(fd), offset_(offset) {
+    }
+  };
+
+  typedef std::vector<Chunk> ChunkList;
+  ChunkList chunks_;
+  size_type chunk_size_;
+  size_type size_;
+  Crc32c *checksum_;
+
+  // Return the last chunk, making sure that it is not full.
+  // If a new chunk is needed, it has at least the capacity minimal.
+  Chunk& Writable(size_type minimal);
+
+  // Write the memory chunks first ... last - 1 to the file descriptor
+  bool OutputChunks(int fd, size_type first, size_type last) const;
+
+#if __cplusplus >= 201103L
+  Builder(const Builder&) = delete;
+  Builder& operator=(const Builder&) = delete;
+#else  // __cplusplus < 201103L
+  Builder(const Builder&);
+  Builder& operator=(const Builder&);
+#endif  // __cplusplus
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_BUILDER_H_
@@ -0,0 +1,142 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/catalog.h"
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+#include "osformat/rcu.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>  // std::exception_ptr
+#include <memory>  // std::unique_ptr
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <system_error>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace osformat {
+
+Catalog::Table::~Table() {
+  for (Map::iterator it(map_.begin()); it != map_.end(); ++it) {
+    delete it->second;
+  }
+}
+
+Error::Code Catalog::Table::Add(const string& key, const string& format) {
+  Template *compiled(new Template(format));
+  Template *&entry = map_[key];
+  delete entry;
+  entry = compiled;
+  return compiled->error();
+}
+
+vector<Error::Code> Catalog::Table::AddAll(const Entries& entries,
+    unsigned int threads) {
+  vector<std::unique_ptr<Template> > compiled(entries.size());
+  vector<Error::Code> errors;
+  errors.reserve(entries.size());
+  // Each thread takes the next chunk of entries which is not taken yet
+  static const std::size_t kChunk = 64;
+  std::atomic<std::size_t> next(0);
+  // The first exception of a thread is rethrown to the caller
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+  auto compile = [&entries, &compiled, &next, &failure, &failure_mutex]() {
+    try {
+      for (;;) {
+        std::size_t begin(next.fetch_add(kChunk, std::memory_order_relaxed));
+        if (begin >= entries.size()) {
+          return;
+        }
+        std::size_t end(std::min(begin + kChunk, entries.size()));
+        for (std::size_t i(begin); i != end; ++i) {
+          compiled[i].reset(new Template(entries[i].second));
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(failure_mutex);
+      if (!failure) {
+        failure = std::current_exception();
+      }
+      // Let the other threads stop early
+      next.store(entries.size(), std::memory_order_relaxed);
+    }
+  };
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  threads = static_cast<unsigned int>(std::min<std::size_t>(threads,
+    (entries.size() + kChunk - 1) / kChunk));
+  vector<std::thread> workers;
+  if (threads > 1) {
+    workers.reserve(threads - 1);
+  }
+  for (unsigned int t(1); t < threads; ++t) {
+    try {
+      workers.emplace_back(compile);
+    } catch (const std::system_error&) {
+      // Continue with the threads already started
+      break;
+    }
+  }
+  compile();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  if (failure) {
+    std::rethrow_exception(failure);
+  }
+  // Create all slots first, so that a failure leaves the map unchanged.
+  // Pointers to the values of an unordered_map stay valid when it grows.
+  vector<Template **> slots;
+  slots.reserve(entries.size());
+  vector<std::size_t> added;
+  added.reserve(entries.size());
+  try {
+    for (std::size_t i(0); i != entries.size(); ++i) {
+      std::pair<Map::iterator, bool> inserted(map_.insert(
+        Map::value_type(entries[i].first, NULL)));
+      slots.push_back(&(inserted.first->second));
+      if (inserted.second) {
+        added.push_back(i);
+      }
+    }
+  } catch (...) {
+    for (std::size_t i : added) {
+      map_.erase(entries[i].first);
+    }
+    throw;
+  }
+  for (std::size_t i(0); i != entries.size(); ++i) {
+    Template *&entry = *slots[i];
+    delete entry;
+    entry = compiled[i].release();
+    errors.push_back(entry->error());
+  }
+  return errors;
+}
+
+void Catalog::Publish(Table *table) {
+  const Table *old(current_.exchange(table));
+  Rcu::Synchronize();
+  delete old;
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
@@ -0,0 +1,129 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_CATALOG_H_
+#define OSFORMAT_CATALOG_H_ 1
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+#include "osformat/rcu.h"
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace osformat {
+
+// A catalog of Templates (e.g. translations), accessible by keys.
+// The whole table can be replaced atomically while other threads render
+// from it: Reading costs neither a lock nor a reference count update
+// (see osformat::Rcu). A replaced table is deleted once all readers which
+// might still use it have left.
+
+class Catalog {
+ public:
+  // An immutable table of Templates once it is published
+  class Table {
+   public:
+    Table() {
+    }
+
+    ~Table();
+
+    // Compile format for key, replacing an earlier definition.
+    // Return the error of the format string (or Error::kNone);
+    // also erroneous templates are stored.
+    Error::Code Add(const std::string& key, const std::string& format);
+
+    typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+    // Compile the formats of all entries (key, format) in parallel with
+    // the given number of threads (0 means one per CPU) and add them as
+    // with Add() in the given order. Return the errors in the same order.
+    // If threads cannot be started, fewer are used. If compiling throws
+    // (e.g. std::bad_alloc), the exception is passed on and nothing is added.
+    std::vector<Error::Code> AddAll(const Entries& entries,
+      unsigned int threads);
+
+    // Return NULL if key is not defined
+    const Template *Find(const std::string& key) const {
+      Map::const_iterator it(map_.find(key));
+      return ((it == map_.end()) ? NULL : it->second);
+    }
+
+    std::size_t size() const {
+      return map_.size();
+    }
+
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+   private:
+    typedef std::unordered_map<std::string, Template *> Map;
+    Map map_;
+  };
+
+  // Access to the current table; the Templates obtained remain valid
+  // for the lifetime of the Reader, even if the catalog is replaced.
+  // Do not call Publish() in the same thread while a Reader exists.
+  class Reader {
+   public:
+    explicit Reader(const Catalog& catalog)
+      : table_(catalog.current_.load(std::memory_order_acquire)) {
+    }
+
+    // Return NULL if key is not defined
+    const Template *Find(const std::string& key) const {
+      return ((table_ == NULL) ? NULL : table_->Find(key));
+    }
+
+    const Table *table() const {
+      return table_;
+    }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+   private:
+    // The read section must be entered before the table is read
+    Rcu::ReadSection section_;
+    const Table *table_;
+  };
+
+  Catalog()
+    : current_(NULL) {
+  }
+
+  // Take ownership of table
+  explicit Catalog(Table *table)
+    : current_(table) {
+  }
+
+  // No Reader must exist anymore
+  ~Catalog() {
+    delete current_.load();
+  }
+
+  // Make table (or NULL) the current table, taking ownership.
+  // This waits until the previous table is no longer used and deletes it.
+  void Publish(Table *table);
+
+  Catalog(const Catalog&) = delete;
+  Catalog& operator=(const Catalog&) = delete;
+
+ private:
+  std::atomic<const Table *> current_;
+};
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
+
+#endif  // OSFORMAT_CATALOG_H_
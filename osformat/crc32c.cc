@@ -0,0 +1,117 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/crc32c.h"
+
+#include "osformat/isa.h"
+
+#include <stdint.h>  // uint32_t, uint64_t
+
+#include <cstdio>  // size_t
+#include <cstring>  // memcpy
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSFORMAT_CRC32C_X86 1
+#include <nmmintrin.h>  // _mm_crc32_*
+#endif
+
+namespace osformat {
+
+// The reflected Castagnoli polynomial
+static const uint32_t kPolynomial = 0x82F63B78;
+
+static uint32_t table[256];
+
+static uint32_t ExtendTable(uint32_t state, const char *s, std::size_t n);
+
+typedef uint32_t (*ExtendFunction)(uint32_t, const char *, std::size_t);
+
+// Return true (for initializing a static)
+static bool InitTable();
+
+static ExtendFunction Selected();
+
+#ifdef OSFORMAT_CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t ExtendHardware(uint32_t state, const char *s, std::size_t n);
+#endif
+
+static uint32_t ExtendTable(uint32_t state, const char *s, std::size_t n) {
+  for (; n != 0; --n) {
+    state = table[(state ^ static_cast<unsigned char>(*(s++))) & 0xFF] ^
+      (state >> 8);
+  }
+  return state;
+}
+
+#ifdef OSFORMAT_CRC32C_X86
+
+__attribute__((target("sse4.2")))
+static uint32_t ExtendHardware(uint32_t state, const char *s, std::size_t n) {
+#ifdef __x86_64__
+  uint64_t state64(state);
+  for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, s, sizeof(word));
+    state64 = _mm_crc32_u64(state64, word);
+    s += sizeof(uint64_t);
+  }
+  state = static_cast<uint32_t>(state64);
+#else  // !defined(__x86_64__)
+  for (; n >= sizeof(uint32_t); n -= sizeof(uint32_t)) {
+    uint32_t word;
+    std::memcpy(&word, s, sizeof(word));
+    state = _mm_crc32_u32(state, word);
+    s += sizeof(uint32_t);
+  }
+#endif  // __x86_64__
+  for (; n != 0; --n) {
+    state = _mm_crc32_u8(state, static_cast<unsigned char>(*(s++)));
+  }
+  return state;
+}
+
+#endif  // OSFORMAT_CRC32C_X86
+
+static bool InitTable() {
+  for (uint32_t i(0); i != 256; ++i) {
+    uint32_t crc(i);
+    for (int bit(0); bit != 8; ++bit) {
+      crc = (crc >> 1) ^ (((crc & 1) != 0) ? kPolynomial : 0);
+    }
+    table[i] = crc;
+  }
+  return true;
+}
+
+// The table is initialized on first usage (independent of static
+// initialization order of other translation units); the function is
+// chosen by the dispatch layer each time, so that Isa::Limit() applies
+static ExtendFunction Selected() {
+#ifdef OSFORMAT_CRC32C_X86
+  if (Isa::Allows(Isa::kSse42)) {
+    return ExtendHardware;
+  }
+#endif
+  static const bool initialized = InitTable();
+  static_cast<void>(initialized);
+  return ExtendTable;
+}
+
+bool Crc32c::Hardware() {
+  return (Isa::Dispatched(Isa::kCrc32c) == Isa::kSse42);
+}
+
+uint32_t Crc32c::Extend(uint32_t state, const char *s, std::size_t n) {
+  return (*Selected())(state, s, n);
+}
+
+}  // namespace osformat
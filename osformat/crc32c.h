@@ -0,0 +1,67 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_CRC32C_H_
+#define OSFORMAT_CRC32C_H_ 1
+
+#include <stdint.h>  // uint32_t
+
+#include <cstdio>  // size_t
+
+#include <string>
+
+namespace osformat {
+
+// An incrementally computed CRC32C (Castagnoli) checksum.
+// If the CPU supports SSE4.2, its crc32 instruction is used; otherwise
+// a table is used.
+// An object can be attached to an osformat::Builder; then all bytes are
+// checksummed while they are copied into the chunks.
+
+class Crc32c {
+ public:
+  Crc32c()
+    : state_(~static_cast<uint32_t>(0)) {
+  }
+
+  void Reset() {
+    state_ = ~static_cast<uint32_t>(0);
+  }
+
+  void Update(const char *s, std::size_t n) {
+    state_ = Extend(state_, s, n);
+  }
+
+  void Update(const std::string& s) {
+    Update(s.data(), s.size());
+  }
+
+  // The checksum of all data passed since construction or the last Reset()
+  uint32_t value() const {
+    return ~state_;
+  }
+
+  static uint32_t Compute(const char *s, std::size_t n) {
+    return ~Extend(~static_cast<uint32_t>(0), s, n);
+  }
+
+  static uint32_t Compute(const std::string& s) {
+    return Compute(s.data(), s.size());
+  }
+
+  // Whether the crc32 instruction is used
+  static bool Hardware();
+
+ private:
+  uint32_t state_;
+
+  static uint32_t Extend(uint32_t state, const char *s, std::size_t n);
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_CRC32C_H_
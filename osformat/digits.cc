@@ -0,0 +1,204 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/digits.h"
+
+#include "osformat/isa.h"
+
+#include <stdint.h>  // uint32_t, uint64_t
+
+#include <cstdio>  // size_t
+#include <cstring>  // memcpy
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSFORMAT_DIGITS_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace osformat {
+
+const std::size_t Digits::kBufferSize;
+
+const char Digits::kPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const uint32_t k10To8 = 100000000;
+
+// Declarations of some static helper functions:
+
+inline static std::size_t DecimalScalar(char *out, uint64_t value);
+
+#ifdef OSFORMAT_DIGITS_X86
+__attribute__((target("sse2")))
+inline static __m128i EightDigits(uint32_t value);
+
+__attribute__((target("sse2")))
+inline static std::size_t StoreWithoutLeadingZeros(char *out, __m128i digits,
+    std::size_t count);
+
+__attribute__((target("sse2")))
+static std::size_t DecimalSse2(char *out, uint64_t value);
+#endif
+
+
+// Definitions of some static helper functions:
+
+inline static std::size_t DecimalScalar(char *out, uint64_t value) {
+  char buffer[24];
+  char *end(buffer + sizeof(buffer));
+  char *begin(Digits::DecimalBackward(end, value, false));
+  std::size_t len(static_cast<std::size_t>(end - begin));
+  std::memcpy(out, begin, len);
+  return len;
+}
+
+#ifdef OSFORMAT_DIGITS_X86
+
+// Convert value < 10^8 into its 8 decimal digits (as 16 bit lanes) in
+// parallel: First split into abcd and efgh, then compute all prefixes
+// a, ab, abc, abcd, e, ef, efg, efgh with multiplications by reciprocals,
+// and finally subtract 10 times the shifted prefixes.
+__attribute__((target("sse2")))
+inline static __m128i EightDigits(uint32_t value) {
+  const __m128i abcdefgh(_mm_cvtsi32_si128(static_cast<int>(value)));
+  const __m128i abcd(_mm_srli_epi64(_mm_mul_epu32(abcdefgh,
+    _mm_set1_epi32(static_cast<int>(0xD1B71759))), 45));
+  const __m128i efgh(_mm_sub_epi32(abcdefgh,
+    _mm_mul_epu32(abcd, _mm_set1_epi32(10000))));
+  const __m128i v1(_mm_unpacklo_epi16(abcd, efgh));
+  const __m128i v1a(_mm_slli_epi64(v1, 2));
+  const __m128i v2a(_mm_unpacklo_epi16(v1a, v1a));
+  const __m128i v2(_mm_unpacklo_epi32(v2a, v2a));
+  const __m128i v3(_mm_mulhi_epu16(v2, _mm_setr_epi16(
+    8389, 5243, 13108, static_cast<int16_t>(0x8000),
+    8389, 5243, 13108, static_cast<int16_t>(0x8000))));
+  const __m128i v4(_mm_mulhi_epu16(v3, _mm_setr_epi16(
+    1 << 7, 1 << 11, 1 << 13, static_cast<int16_t>(0x8000),
+    1 << 7, 1 << 11, 1 << 13, static_cast<int16_t>(0x8000))));
+  const __m128i v5(_mm_mullo_epi16(v4, _mm_set1_epi16(10)));
+  const __m128i v6(_mm_slli_epi64(v5, 16));
+  return _mm_sub_epi16(v4, v6);
+}
+
+// digits contains count (8 or 16) digits as bytes (without '0' added)
+__attribute__((target("sse2")))
+inline static std::size_t StoreWithoutLeadingZeros(char *out, __m128i digits,
+    std::size_t count) {
+  unsigned int nonzero(~static_cast<unsigned int>(_mm_movemask_epi8(
+    _mm_cmpeq_epi8(digits, _mm_setzero_si128()))) | (1U << (count - 1)));
+  std::size_t skip(static_cast<std::size_t>(__builtin_ctz(nonzero)));
+  char buffer[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer),
+    _mm_add_epi8(digits, _mm_set1_epi8('0')));
+  std::memcpy(out, buffer + skip, count - skip);
+  return count - skip;
+}
+
+__attribute__((target("sse2")))
+static std::size_t DecimalSse2(char *out, uint64_t value) {
+  // Short numbers are faster with the table
+  if (value < 10000) {
+    return DecimalScalar(out, value);
+  }
+  if (value < k10To8) {
+    return StoreWithoutLeadingZeros(out, _mm_packus_epi16(
+      EightDigits(static_cast<uint32_t>(value)), _mm_setzero_si128()), 8);
+  }
+  // Up to 4 leading digits are written with the table, the remaining
+  // 16 digits in parallel
+  static const uint64_t k10To16(static_cast<uint64_t>(k10To8) * k10To8);
+  std::size_t len(0);
+  if (value >= k10To16) {
+    len = DecimalScalar(out, value / k10To16);
+    value %= k10To16;
+  }
+  __m128i digits(_mm_packus_epi16(
+    EightDigits(static_cast<uint32_t>(value / k10To8)),
+    EightDigits(static_cast<uint32_t>(value % k10To8))));
+  if (len != 0) {
+    char buffer[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer),
+      _mm_add_epi8(digits, _mm_set1_epi8('0')));
+    std::memcpy(out + len, buffer, 16);
+    return len + 16;
+  }
+  return StoreWithoutLeadingZeros(out, digits, 16);
+}
+
+#endif  // OSFORMAT_DIGITS_X86
+
+char *Digits::DecimalBackward(char *end, uint64_t value, bool full) {
+  char *full_begin(full ? (end - 19) : end);
+  while (value >= 100) {
+    std::size_t pair(static_cast<std::size_t>(value % 100) * 2);
+    value /= 100;
+    *(--end) = kPairs[pair + 1];
+    *(--end) = kPairs[pair];
+  }
+  if (value >= 10) {
+    std::size_t pair(static_cast<std::size_t>(value) * 2);
+    *(--end) = kPairs[pair + 1];
+    *(--end) = kPairs[pair];
+  } else {
+    *(--end) = static_cast<char>('0' + value);
+  }
+  while (end > full_begin) {
+    *(--end) = '0';
+  }
+  return end;
+}
+
+std::size_t Digits::Decimal(char *out, uint64_t value) {
+  return DecimalScalar(out, value);
+}
+
+Digits::DecimalFunction Digits::DecimalKernel() {
+#ifdef OSFORMAT_DIGITS_X86
+  if (Isa::Allows(Isa::kSse2)) {
+    return DecimalSse2;
+  }
+#endif
+  return Decimal;
+}
+
+std::size_t Digits::Hex(char *out, uint64_t value, bool uppercase) {
+  const char *digits(uppercase ? "0123456789ABCDEF" : "0123456789abcdef");
+  std::size_t len(1);
+  for (uint64_t rest(value >> 4); rest != 0; rest >>= 4) {
+    ++len;
+  }
+  for (char *curr(out + len); curr != out; value >>= 4) {
+    *(--curr) = digits[value & 15];
+  }
+  return len;
+}
+
+std::size_t Digits::Octal(char *out, uint64_t value) {
+  std::size_t len(1);
+  for (uint64_t rest(value >> 3); rest != 0; rest >>= 3) {
+    ++len;
+  }
+  for (char *curr(out + len); curr != out; value >>= 3) {
+    *(--curr) = static_cast<char>('0' + (value & 7));
+  }
+  return len;
+}
+
+}  // namespace osformat
@@ -0,0 +1,58 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_DIGITS_H_
+#define OSFORMAT_DIGITS_H_ 1
+
+#include <stdint.h>  // uint64_t
+
+#include <cstdio>  // size_t
+
+namespace osformat {
+
+// Internal kernels for converting integers into digits.
+// This header is not installed.
+
+class Digits {
+ public:
+  // Space sufficient for the digits of any 64 bit number in any base
+  // (plus some slack which the vectorized kernels may use)
+#if __cplusplus >= 201103L
+  constexpr
+#endif
+  static const std::size_t kBufferSize = 80;
+
+  // Write the decimal digits of value to out; return the number of digits
+  static std::size_t Decimal(char *out, uint64_t value);
+
+  typedef std::size_t (*DecimalFunction)(char *out, uint64_t value);
+
+  // Return a function equivalent to Decimal(), using the fastest kernel
+  // allowed by Isa. This is meant to be called once before a bulk loop.
+  static DecimalFunction DecimalKernel();
+
+  // Write the decimal digits of value so that they end before end:
+  // At least one digit, or exactly 19 digits if full (value < 10^19).
+  // Return the beginning.
+  static char *DecimalBackward(char *end, uint64_t value, bool full);
+
+  // Write the hexadecimal/octal digits of value to out;
+  // return the number of digits
+  static std::size_t Hex(char *out, uint64_t value, bool uppercase);
+
+  static std::size_t Octal(char *out, uint64_t value);
+
+  // The pairs "00" "01" ... "99"
+  static const char kPairs[];
+
+ private:
+  Digits() {}  // Do not instantiate this purely static class by accident
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_DIGITS_H_
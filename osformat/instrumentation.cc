@@ -0,0 +1,162 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/instrumentation.h"
+
+#include "osformat/isa.h"
+#include "osformat/osformat.h"
+
+#include <stdint.h>  // uint64_t
+
+#include <cassert>  // assert
+
+#include <string>
+
+#if __cplusplus >= 201103L
+#include <algorithm>
+#include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+#include <vector>
+#endif
+
+using std::string;
+
+namespace osformat {
+
+const char *Instrumentation::Names[] = {
+  "sampled_kept",
+  "sampled_dropped",
+  "memo_hits",
+  "memo_misses"
+};
+
+const char *Instrumentation::c_str(Counter c) {
+  unsigned int index(static_cast<unsigned int>(c));
+  assert(index < static_cast<unsigned int>(kEnd));
+  return Names[index];
+}
+
+void Instrumentation::Dump(string *append) {
+  for (unsigned int i(0); i != static_cast<unsigned int>(kEnd); ++i) {
+    Counter c(static_cast<Counter>(i));
+    Format(append, "%s %s\n") % c_str(c) % Get(c);
+  }
+  Format(append, "isa_supported %s\nisa_used %s\n") %
+    Isa::c_str(Isa::Supported()) % Isa::c_str(Isa::Used());
+  for (unsigned int i(0); i != static_cast<unsigned int>(Isa::kKernelEnd);
+    ++i) {
+    Isa::Kernel kernel(static_cast<Isa::Kernel>(i));
+    Format(append, "kernel_%s %s\n") % Isa::c_str(kernel) %
+      Isa::c_str(Isa::Dispatched(kernel));
+  }
+}
+
+#if __cplusplus >= 201103L
+
+// The slots of a thread; only this thread writes them
+class alignas(64) InstrumentationSlots {
+ public:
+  std::atomic<uint64_t> counts_[Instrumentation::kEnd];
+
+  InstrumentationSlots();
+
+  ~InstrumentationSlots();
+};
+
+typedef std::vector<InstrumentationSlots *> InstrumentationSlotsList;
+
+// Declarations of some static helper functions:
+
+static std::mutex& Registry();
+
+static InstrumentationSlotsList& AllSlots();
+
+// The sums of the counters of finished threads
+static uint64_t *Retired();
+
+static InstrumentationSlots& ThisSlots();
+
+
+// Definitions of some static helper functions:
+
+// Function-local statics are independent of static initialization order
+
+static std::mutex& Registry() {
+  static std::mutex registry;
+  return registry;
+}
+
+static InstrumentationSlotsList& AllSlots() {
+  static InstrumentationSlotsList all_slots;
+  return all_slots;
+}
+
+static uint64_t *Retired() {
+  static uint64_t retired[Instrumentation::kEnd];
+  return retired;
+}
+
+static InstrumentationSlots& ThisSlots() {
+  static thread_local InstrumentationSlots slots;
+  return slots;
+}
+
+InstrumentationSlots::InstrumentationSlots() {
+  for (unsigned int i(0); i != Instrumentation::kEnd; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+  std::lock_guard<std::mutex> lock(Registry());
+  AllSlots().push_back(this);
+}
+
+InstrumentationSlots::~InstrumentationSlots() {
+  std::lock_guard<std::mutex> lock(Registry());
+  uint64_t *retired(Retired());
+  for (unsigned int i(0); i != Instrumentation::kEnd; ++i) {
+    retired[i] += counts_[i].load(std::memory_order_relaxed);
+  }
+  InstrumentationSlotsList& all_slots = AllSlots();
+  all_slots.erase(std::find(all_slots.begin(), all_slots.end(), this));
+}
+
+void Instrumentation::Add(Counter c, uint64_t n) {
+  // No read-modify-write is needed since only this thread writes
+  std::atomic<uint64_t>& count = ThisSlots().counts_[c];
+  count.store(count.load(std::memory_order_relaxed) + n,
+    std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::Get(Counter c) {
+  std::lock_guard<std::mutex> lock(Registry());
+  uint64_t sum(Retired()[c]);
+  const InstrumentationSlotsList& all_slots = AllSlots();
+  for (InstrumentationSlotsList::const_iterator it(all_slots.begin());
+    it != all_slots.end(); ++it) {
+    sum += (*it)->counts_[c].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+#else  // __cplusplus < 201103L
+
+static uint64_t counts[Instrumentation::kEnd];
+
+void Instrumentation::Add(Counter c, uint64_t n) {
+  counts[c] += n;
+}
+
+uint64_t Instrumentation::Get(Counter c) {
+  return counts[c];
+}
+
+#endif  // __cplusplus >= 201103L
+
+}  // namespace osformat
@@ -0,0 +1,60 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_INSTRUMENTATION_H_
+#define OSFORMAT_INSTRUMENTATION_H_ 1
+
+#include <stdint.h>  // uint64_t
+
+#include <string>
+
+namespace osformat {
+
+// Process-wide event counters of the library.
+// Each thread counts into its own slots (no shared cache line is written);
+// Get() sums up the slots of all threads, including finished threads.
+// When the library is compiled without C++11, the counters are global
+// and not thread-safe.
+
+class Instrumentation {
+ public:
+  enum Counter {
+    kSampledKept = 0,  // Messages kept by a Sampler
+    kSampledDropped,  // Messages muted by a Sampler
+    kMemoHits,  // Results taken from a Memo
+    kMemoMisses,  // Results rendered by a Memo
+    kEnd
+  };
+
+  static void Add(Counter c, uint64_t n);
+
+  static void Increment(Counter c) {
+    Add(c, 1);
+  }
+
+  static uint64_t Get(Counter c);
+
+  // The name of the counter (static; must not be freed)
+  static const char *c_str(Counter c);
+
+  // Append one line "name value" for each counter, followed by the
+  // instruction sets chosen by the dispatch layer (see osformat/isa.h)
+  static void Dump(std::string *append);
+
+ private:
+  static const char *Names[];
+
+#if __cplusplus >= 201103L
+  Instrumentation() = delete;
+#else  // __cplusplus < 201103L
+  Instrumentation() {}
+#endif  // __cplusplus
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_INSTRUMENTATION_H_
@@ -0,0 +1,158 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/isa.h"
+
+#include <cassert>  // assert
+#include <cstdlib>  // getenv
+#include <cstring>  // strcmp
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSFORMAT_ISA_X86 1
+#endif
+
+namespace osformat {
+
+const char *Isa::LevelNames[] = {
+  "generic",
+  "sse2",
+  "sse4.2",
+  "avx2",
+  "avx512"
+};
+
+const char *Isa::KernelNames[] = {
+  "crc32c",
+  "decimal"
+};
+
+// The highest level for which each kernel has an implementation
+static const Isa::Level kBest[] = {
+#ifdef OSFORMAT_ISA_X86
+  Isa::kSse42,
+  Isa::kSse2
+#else
+  Isa::kGeneric,
+  Isa::kGeneric
+#endif
+};
+
+#if __cplusplus >= 201103L
+typedef std::atomic<int> UsedLevel;
+#else
+typedef int UsedLevel;
+#endif
+
+// Declarations of some static helper functions:
+
+static Isa::Level Detect();
+
+// The level named by OSFORMAT_ISA (or Isa::kEnd)
+static Isa::Level FromEnvironment();
+
+// The level to use before Isa::Limit() is called
+static Isa::Level Initial();
+
+static UsedLevel& Current();
+
+
+// Definitions of some static helper functions:
+
+static Isa::Level Detect() {
+#ifdef OSFORMAT_ISA_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return Isa::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return Isa::kSse42;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return Isa::kSse2;
+  }
+#endif
+  return Isa::kGeneric;
+}
+
+static Isa::Level FromEnvironment() {
+  const char *name(std::getenv("OSFORMAT_ISA"));
+  if (name != NULL) {
+    for (int i(0); i != Isa::kEnd; ++i) {
+      Isa::Level level(static_cast<Isa::Level>(i));
+      if (std::strcmp(name, Isa::c_str(level)) == 0) {
+        return level;
+      }
+    }
+  }
+  return Isa::kEnd;
+}
+
+static Isa::Level Initial() {
+  Isa::Level limit(FromEnvironment());
+  return ((limit < Isa::Supported()) ? limit : Isa::Supported());
+}
+
+// Function-local statics are independent of static initialization order
+
+static UsedLevel& Current() {
+  static UsedLevel current(static_cast<int>(Initial()));
+  return current;
+}
+
+Isa::Level Isa::Supported() {
+  static const Level supported = Detect();
+  return supported;
+}
+
+Isa::Level Isa::Used() {
+#if __cplusplus >= 201103L
+  return static_cast<Level>(Current().load(std::memory_order_relaxed));
+#else
+  return static_cast<Level>(Current());
+#endif
+}
+
+void Isa::Limit(Level level) {
+  Level used((level < Supported()) ? level : Supported());
+#if __cplusplus >= 201103L
+  Current().store(static_cast<int>(used), std::memory_order_relaxed);
+#else
+  Current() = static_cast<int>(used);
+#endif
+}
+
+Isa::Level Isa::Dispatched(Kernel kernel) {
+  unsigned int index(static_cast<unsigned int>(kernel));
+  assert(index < static_cast<unsigned int>(kKernelEnd));
+  Level used(Used());
+  return ((kBest[index] < used) ? kBest[index] : used);
+}
+
+const char *Isa::c_str(Level level) {
+  unsigned int index(static_cast<unsigned int>(level));
+  assert(index < static_cast<unsigned int>(kEnd));
+  return LevelNames[index];
+}
+
+const char *Isa::c_str(Kernel kernel) {
+  unsigned int index(static_cast<unsigned int>(kernel));
+  assert(index < static_cast<unsigned int>(kKernelEnd));
+  return KernelNames[index];
+}
+
+}  // namespace osformat
@@ -0,0 +1,77 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_ISA_H_
+#define OSFORMAT_ISA_H_ 1
+
+namespace osformat {
+
+// The dispatch layer for the vectorized kernels of the library:
+// The library is compiled for the baseline of the architecture; on x86,
+// the kernels for higher instruction sets are compiled with target
+// attributes and chosen at runtime according to the CPU (and the limit),
+// so that one binary uses the best kernels on every machine.
+// The levels can be limited (e.g. for comparing kernels) by Limit() or
+// by the environment variable OSFORMAT_ISA (read on first usage) which can
+// be one of the names returned by c_str().
+// The choices are listed by Instrumentation::Dump().
+
+class Isa {
+ public:
+  // The levels are ordered: A CPU supporting one supports all lower ones
+  enum Level {
+    kGeneric = 0,  // Portable code
+    kSse2,
+    kSse42,
+    kAvx2,
+    kAvx512,
+    kEnd
+  };
+
+  // The kernels which are dispatched
+  enum Kernel {
+    kCrc32c = 0,  // Crc32c (SSE4.2)
+    kDecimal,  // Conversion of integers in numbers() (SSE2)
+    kKernelEnd
+  };
+
+  // The highest level supported by the CPU (and operating system)
+  static Level Supported();
+
+  // The highest level used by kernels: Supported() or the limit
+  static Level Used();
+
+  static bool Allows(Level level) {
+    return (level <= Used());
+  }
+
+  // Use at most level from now on; kEnd means no limit
+  static void Limit(Level level);
+
+  // The level currently used by the kernel
+  static Level Dispatched(Kernel kernel);
+
+  // The name of the level or kernel (static; must not be freed)
+  static const char *c_str(Level level);
+
+  static const char *c_str(Kernel kernel);
+
+ private:
+  static const char *LevelNames[];
+
+  static const char *KernelNames[];
+
+#if __cplusplus >= 201103L
+  Isa() = delete;
+#else  // __cplusplus < 201103L
+  Isa() {}
+#endif  // __cplusplus
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_ISA_H_
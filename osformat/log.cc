@@ -0,0 +1,47 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/log.h"
+
+#if __cplusplus >= 201103L
+
+#include "osformat/rcu.h"
+
+#include <cstdio>  // FILE, fflush, fclose
+
+namespace osformat {
+
+Log::Config::~Config() {
+  if (file_ == NULL) {
+    return;
+  }
+  if (close_) {
+    std::fclose(file_);
+  } else {
+    std::fflush(file_);
+  }
+}
+
+bool Log::Enabled(unsigned int level) const {
+  Rcu::ReadSection section;
+  const Config *config(current_.load(std::memory_order_acquire));
+  return ((config != NULL) && config->Enabled(level));
+}
+
+void Log::Configure(Config *config) {
+  const Config *old(current_.exchange(config));
+  Rcu::Synchronize();
+  delete old;
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
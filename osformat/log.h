@@ -0,0 +1,161 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_LOG_H_
+#define OSFORMAT_LOG_H_ 1
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+#include "osformat/rcu.h"
+
+#include <atomic>
+#include <cstdio>  // FILE
+#include <string>
+
+namespace osformat {
+
+// A log with a level and a sink which can be reconfigured at runtime
+// while other threads output messages: The configuration is an immutable
+// snapshot which a message reads with a single atomic load inside a read
+// section (see osformat::Rcu), so neither a lock nor a reference count
+// update is needed. A replaced configuration is retired (its file is
+// flushed and possibly closed) once all messages which might still use
+// it are finished.
+
+class Log {
+ public:
+  // An immutable configuration once it is published:
+  // Messages of a level up to level are output to file (if not NULL)
+  class Config {
+   public:
+    // If close, file is closed when the configuration is retired
+    Config(unsigned int level, FILE *file, bool close)
+      : level_(level), file_(file), close_(close) {
+    }
+
+    Config(unsigned int level, FILE *file)
+      : level_(level), file_(file), close_(false) {
+    }
+
+    // Flush (or close) file
+    ~Config();
+
+    unsigned int level() const {
+      return level_;
+    }
+
+    FILE *file() const {
+      return file_;
+    }
+
+    bool Enabled(unsigned int level) const {
+      return ((level <= level_) && (file_ != NULL));
+    }
+
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+
+   private:
+    unsigned int level_;
+    FILE *file_;
+    bool close_;
+  };
+
+ private:
+  // Pin the current configuration: The read section must be entered
+  // before the configuration is read
+  class Pin {
+   protected:
+    explicit Pin(const Log& log)
+      : config_(log.current_.load(std::memory_order_acquire)) {
+    }
+
+    Special Flags(unsigned int level, Special flags) const {
+      return (((config_ != NULL) && config_->Enabled(level)) ?
+        (flags | Special::kNewline) :
+        (flags | Special::kNewline | Special::kMute));
+    }
+
+    FILE *file() const {
+      return ((config_ == NULL) ? NULL : config_->file());
+    }
+
+   private:
+    Rcu::ReadSection section_;
+    const Config *config_;
+  };
+
+ public:
+  // A line of the given level (a newline is appended): It is output to
+  // the file of the configuration current at construction if the level is
+  // enabled there; otherwise, it is muted (arguments are not converted).
+  // Do not call Configure() in the same thread while a Message exists.
+  class Message : private Pin, public Format {
+   public:
+    Message(const Log& log, unsigned int level, const char *format,
+        Special flags)
+      : Pin(log), Format(file(), format, Flags(level, flags)) {
+    }
+
+    Message(const Log& log, unsigned int level, const std::string& format,
+        Special flags)
+      : Pin(log), Format(file(), format, Flags(level, flags)) {
+    }
+
+    Message(const Log& log, unsigned int level, const Template& plan,
+        Special flags)
+      : Pin(log), Format(file(), plan, Flags(level, flags)) {
+    }
+
+    Message(const Log& log, unsigned int level, const char *format)
+      : Pin(log), Format(file(), format, Flags(level, Special::None())) {
+    }
+
+    Message(const Log& log, unsigned int level, const std::string& format)
+      : Pin(log), Format(file(), format, Flags(level, Special::None())) {
+    }
+
+    Message(const Log& log, unsigned int level, const Template& plan)
+      : Pin(log), Format(file(), plan, Flags(level, Special::None())) {
+    }
+  };
+
+  Log()
+    : current_(NULL) {
+  }
+
+  // Take ownership of config
+  explicit Log(Config *config)
+    : current_(config) {
+  }
+
+  // No Message must exist anymore
+  ~Log() {
+    delete current_.load();
+  }
+
+  // Whether a Message of level would currently be output
+  bool Enabled(unsigned int level) const;
+
+  // Make config (or NULL) the current configuration, taking ownership.
+  // This waits until the previous configuration is no longer used by any
+  // Message and retires it.
+  void Configure(Config *config);
+
+  Log(const Log&) = delete;
+  Log& operator=(const Log&) = delete;
+
+ private:
+  std::atomic<const Config *> current_;
+};
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
+
+#endif  // OSFORMAT_LOG_H_
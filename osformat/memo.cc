@@ -0,0 +1,55 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/memo.h"
+
+#if __cplusplus >= 201103L
+
+#include "osformat/instrumentation.h"
+#include "osformat/osformat.h"
+#include "osformat/streams.h"
+
+#include <cstdio>  // FILE
+#include <string>
+#include <vector>
+
+using std::string;
+
+namespace osformat {
+
+const std::size_t Memo::kDefaultSlots;
+
+void Memo::Clear() {
+  for (std::vector<Entry>::iterator it(slots_.begin());
+    it != slots_.end(); ++it) {
+    it->valid_ = false;
+  }
+}
+
+void Memo::Count(bool hit) {
+  if (hit) {
+    ++hits_;
+    Instrumentation::Increment(Instrumentation::kMemoHits);
+  } else {
+    ++misses_;
+    Instrumentation::Increment(Instrumentation::kMemoMisses);
+  }
+}
+
+bool Memo::Write(FILE *file, const string& text) const {
+  Error::Code error;
+  Ordered::Write(file, text, flags_.HaveBits(Special::kFlush), &error);
+  return (error == Error::kNone);
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
@@ -0,0 +1,187 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_MEMO_H_
+#define OSFORMAT_MEMO_H_ 1
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+
+#include <stdint.h>  // uint64_t
+
+#include <cstdio>  // size_t, FILE
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace osformat {
+
+// Used internally by Memo: Serialize arguments into a key.
+// Each argument is preceded by an identifier of its type, since e.g.
+// a char and an int of the same value are output differently.
+
+class MemoKey {
+ public:
+  template<class T> static void Append(std::string *key, const T& value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+      std::is_pointer<T>::value,
+      "Memo arguments must be numbers, enums, pointers, or strings");
+    AppendType<T>(key);
+    key->append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  static void Append(std::string *key, const std::string& value) {
+    AppendType<std::string>(key);
+    AppendString(key, value.data(), value.size());
+  }
+
+  static void Append(std::string *key, const char *value) {
+    AppendType<const char *>(key);
+    if (value == NULL) {
+      key->push_back(0);
+    } else {
+      key->push_back(1);
+      AppendString(key, value, std::char_traits<char>::length(value));
+    }
+  }
+
+  static void Append(std::string *key, char *value) {
+    Append(key, static_cast<const char *>(value));
+  }
+
+  MemoKey() = delete;
+
+ private:
+  // The address of Id<T>::id_ identifies T
+  template<class T> class Id {
+   public:
+    static const char id_;
+  };
+
+  template<class T> static void AppendType(std::string *key) {
+    const char *id(&Id<T>::id_);
+    key->append(reinterpret_cast<const char *>(&id), sizeof(id));
+  }
+
+  static void AppendString(std::string *key, const char *data,
+      std::size_t size) {
+    key->append(reinterpret_cast<const char *>(&size), sizeof(size));
+    key->append(data, size);
+  }
+};
+
+template<class T> const char MemoKey::Id<T>::id_ = 0;
+
+// Cache the results of a Template for repeated identical arguments
+// (e.g. status lines): A hit returns the stored text without converting
+// any argument. Arguments must be numbers, enums, pointers (which are
+// compared as addresses), std::string or C strings (compared by content).
+// The memory is bounded by a fixed number of slots; a new result replaces
+// the result in its slot. The hits and misses are also counted in
+// Instrumentation::kMemoHits and Instrumentation::kMemoMisses.
+// A Memo is not thread-safe; the Template must outlive the Memo.
+
+class Memo {
+ public:
+  static const std::size_t kDefaultSlots = 64;
+
+  Memo(const Template& plan, Special flags, std::size_t slots)
+    : plan_(plan), flags_(flags), slots_((slots == 0) ? 1 : slots),
+    error_(Error::kNone), hits_(0), misses_(0) {
+  }
+
+  Memo(const Template& plan, Special flags)
+    : Memo(plan, flags, kDefaultSlots) {
+  }
+
+  explicit Memo(const Template& plan)
+    : Memo(plan, Special::None(), kDefaultSlots) {
+  }
+
+  // Return the text for args; the reference is valid until the next call.
+  // In case of an error, the text of the failed Format is returned
+  // (and not cached), and error() is set.
+  template<class... Args> const std::string& Render(const Args&... args) {
+    key_.clear();
+    int keys[] = { 0, (MemoKey::Append(&key_, args), 0)... };
+    static_cast<void>(keys);
+    Entry& entry(slots_[std::hash<std::string>()(key_) % slots_.size()]);
+    if (entry.valid_ && (entry.key_ == key_)) {
+      error_ = Error::kNone;
+      Count(true);
+      return entry.text_;
+    }
+    Count(false);
+    bool success;
+    Format format(&success, plan_, flags_);
+    int inserted[] = { 0, (format % args, 0)... };
+    static_cast<void>(inserted);
+    entry.text_ = format.str();
+    error_ = format.error();
+    entry.valid_ = (error_ == Error::kNone);
+    if (entry.valid_) {
+      entry.key_.swap(key_);
+    }
+    return entry.text_;
+  }
+
+  // Output Render(args...) to file (honouring the Flush flag,
+  // osformat::Pipeline, and osformat::Ordered). Return false on error.
+  template<class... Args> bool Output(FILE *file, const Args&... args) {
+    const std::string& text(Render(args...));
+    return ((error_ == Error::kNone) && Write(file, text));
+  }
+
+  // The error of the most recent call (or Error::kNone)
+  Error::Code error() const {
+    return error_;
+  }
+
+  uint64_t hits() const {
+    return hits_;
+  }
+
+  uint64_t misses() const {
+    return misses_;
+  }
+
+  // Forget all cached results
+  void Clear();
+
+  Memo(const Memo&) = delete;
+  Memo& operator=(const Memo&) = delete;
+
+ private:
+  class Entry {
+   public:
+    std::string key_, text_;
+    bool valid_;
+
+    Entry()
+      : valid_(false) {
+    }
+  };
+
+  const Template& plan_;
+  Special flags_;
+  std::vector<Entry> slots_;
+  std::string key_;  // reused to avoid allocations
+  Error::Code error_;
+  uint64_t hits_, misses_;
+
+  void Count(bool hit);
+
+  bool Write(FILE *file, const std::string& text) const;
+};
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
+
+#endif  // OSFORMAT_MEMO_H_
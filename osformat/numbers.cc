@@ -0,0 +1,194 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/osformat.h"
+
+#include "osformat/digits.h"
+
+#include <stdint.h>  // uint64_t
+
+#include <cstdio>  // size_t
+
+#include <ios>
+#include <limits>
+#include <locale>
+#include <ostream>
+#include <string>
+
+using std::ios_base;
+using std::ostream;
+using std::streamsize;
+using std::string;
+
+namespace osformat {
+
+// Declarations of some static helper functions:
+
+template<class T, class U> static bool WriteIntegers(ostream *os,
+    const T *data, std::size_t size, const char *separator);
+
+
+// Definitions of some static helper functions:
+
+// Convert all numbers into one string which is then written at once.
+// The result is the same as with operator<< for each element.
+// Return false if this is not possible since the locale requires grouping.
+template<class T, class U> static bool WriteIntegers(ostream *os,
+    const T *data, std::size_t size, const char *separator) {
+  const std::numpunct<char>& punct(
+    std::use_facet<std::numpunct<char> >(os->getloc()));
+  string grouping(punct.grouping());
+  if (!grouping.empty() && (grouping[0] > 0)) {
+    return false;
+  }
+  ios_base::fmtflags flags(os->flags());
+  ios_base::fmtflags base(flags & ios_base::basefield);
+  ios_base::fmtflags adjust(flags & ios_base::adjustfield);
+  bool uppercase((flags & ios_base::uppercase) != 0);
+  bool showbase((flags & ios_base::showbase) != 0);
+  bool showpos(std::numeric_limits<T>::is_signed &&
+    ((flags & ios_base::showpos) != 0));
+  std::size_t width((os->width() > 0) ?
+    static_cast<std::size_t>(os->width()) : 0);
+  char fill(os->fill());
+  // The kernel is chosen once for all elements
+  Digits::DecimalFunction decimal(Digits::DecimalKernel());
+  string::size_type separator_len(string::traits_type::length(separator));
+  string result;
+  result.reserve(size * (((width > 8) ? width : 8) + separator_len));
+  for (std::size_t i(0); i != size; ++i) {
+    if (i != 0) {
+      result.append(separator, separator_len);
+    }
+    char buffer[Digits::kBufferSize];
+    char *curr(buffer);
+    std::size_t prefix_len(0);
+    U value(static_cast<U>(data[i]));
+    if (base == ios_base::hex) {
+      if (showbase && (value != 0)) {
+        *(curr++) = '0';
+        *(curr++) = (uppercase ? 'X' : 'x');
+        prefix_len = 2;
+      }
+      curr += Digits::Hex(curr, value, uppercase);
+    } else if (base == ios_base::oct) {
+      // The leading 0 does not count as prefix for internal adjustment
+      if (showbase && (value != 0)) {
+        *(curr++) = '0';
+      }
+      curr += Digits::Octal(curr, value);
+    } else {
+      if (value > static_cast<U>(std::numeric_limits<T>::max())) {
+        *(curr++) = '-';
+        value = static_cast<U>(0 - value);
+        prefix_len = 1;
+      } else if (showpos) {
+        *(curr++) = '+';
+        prefix_len = 1;
+      }
+      curr += decimal(curr, value);
+    }
+    std::size_t len(static_cast<std::size_t>(curr - buffer));
+    if (len >= width) {
+      result.append(buffer, len);
+    } else if (adjust == ios_base::left) {
+      result.append(buffer, len);
+      result.append(width - len, fill);
+    } else if (adjust == ios_base::internal) {
+      result.append(buffer, prefix_len);
+      result.append(width - len, fill);
+      result.append(buffer + prefix_len, len - prefix_len);
+    } else {
+      result.append(width - len, fill);
+      result.append(buffer, len);
+    }
+  }
+  os->write(result.data(), static_cast<streamsize>(result.size()));
+  os->width(0);
+  return true;
+}
+
+void Format::WriteNumbers(ostream *os,
+    const short *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<short, unsigned short>(  // NOLINT(runtime/int)
+    os, data, size, separator)) {
+    WriteNumbers<short>(os, data, size, separator);  // NOLINT(runtime/int)
+  }
+}
+
+void Format::WriteNumbers(ostream *os,
+    const unsigned short *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<unsigned short,  // NOLINT(runtime/int)
+    unsigned short>(os, data, size, separator)) {  // NOLINT(runtime/int)
+    WriteNumbers<unsigned short>(  // NOLINT(runtime/int)
+      os, data, size, separator);
+  }
+}
+
+void Format::WriteNumbers(ostream *os, const int *data,
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<int, unsigned int>(os, data, size, separator)) {
+    WriteNumbers<int>(os, data, size, separator);
+  }
+}
+
+void Format::WriteNumbers(ostream *os, const unsigned int *data,
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<unsigned int, unsigned int>(os, data, size, separator)) {
+    WriteNumbers<unsigned int>(os, data, size, separator);
+  }
+}
+
+void Format::WriteNumbers(ostream *os,
+    const long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<long, unsigned long>(  // NOLINT(runtime/int)
+    os, data, size, separator)) {
+    WriteNumbers<long>(os, data, size, separator);  // NOLINT(runtime/int)
+  }
+}
+
+void Format::WriteNumbers(ostream *os,
+    const unsigned long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<unsigned long,  // NOLINT(runtime/int)
+    unsigned long>(os, data, size, separator)) {  // NOLINT(runtime/int)
+    WriteNumbers<unsigned long>(  // NOLINT(runtime/int)
+      os, data, size, separator);
+  }
+}
+
+#if __cplusplus >= 201103L
+
+void Format::WriteNumbers(ostream *os,
+    const long long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<long long,  // NOLINT(runtime/int)
+    unsigned long long>(os, data, size, separator)) {  // NOLINT(runtime/int)
+    WriteNumbers<long long>(os, data, size, separator);  // NOLINT(runtime/int)
+  }
+}
+
+void Format::WriteNumbers(ostream *os,
+    const unsigned long long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator) {
+  if (!WriteIntegers<unsigned long long,  // NOLINT(runtime/int)
+    unsigned long long>(os, data, size, separator)) {  // NOLINT(runtime/int)
+    WriteNumbers<unsigned long long>(  // NOLINT(runtime/int)
+      os, data, size, separator);
+  }
+}
+
+#endif  // __cplusplus >= 201103L
+
+}  // namespace osformat
@@ -0,0 +1,284 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+// Replay a corpus of format strings with argument signatures (see
+// osformat-bench-corpus.txt for the file format) through several ways of
+// formatting. Report the throughput of each way and the templates which
+// are much slower than the median.
+// Usage: osformat-bench-corpus corpus_file [iterations]
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/osformat.h"
+
+#include <algorithm>
+#include <cstdio>  // FILE, fopen, fclose, tmpfile
+#include <cstdlib>  // strtoul
+#include <ctime>  // clock
+
+#include <fstream>
+#include <locale>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>  // dup, dup2, close
+#endif
+
+using std::string;
+
+using osformat::Format;
+using osformat::Say;
+using osformat::SayError;
+using osformat::Special;
+using osformat::Template;
+
+class Entry {
+ public:
+  string signature_, format_;
+  string escaped_;  // format_ as in the corpus
+  Template *plan_;
+  std::size_t size_;  // of the result
+  double seconds_[5];
+};
+
+typedef std::vector<Entry> Corpus;
+
+static const char *const kModes[] = {
+  "Format",  // parse the format string each time
+  "Template",  // use a precompiled Template
+  "append",  // append to a string, using a Template
+  "Say",  // Say (to stdout redirected to the FILE), using a Template
+  "file",  // output with newline to a FILE, using a Template
+  NULL
+};
+
+static const int kSayMode = 3;
+
+static const string kString("some text");
+
+static void Apply(Format *format, const string& signature) {
+  for (string::size_type i(0); i != signature.size(); ++i) {
+    switch (signature[i]) {
+      case 'i':
+        *format % -12345;
+        break;
+      case 'u':
+        *format % 4711U;
+        break;
+      case 'l':
+        *format % 1234567890L;  // NOLINT(runtime/int)
+        break;
+      case 'z':
+        *format % string::npos;
+        break;
+      case 'w':
+        *format % 6;
+        break;
+      case 'd':
+        *format % 3.14159;
+        break;
+      case 'c':
+        *format % 'x';
+        break;
+      case 'b':
+        *format % true;
+        break;
+      case 's':
+        *format % kString;
+        break;
+      case 'p':
+        *format % "text";
+        break;
+      case 'L':
+        *format % std::locale::classic();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Remove the escapes \n, \t, and \\ .
+static string Unescape(const string& text) {
+  string result;
+  for (string::size_type i(0); i != text.size(); ++i) {
+    char c(text[i]);
+    if ((c == '\\') && (i + 1 != text.size())) {
+      c = text[++i];
+      if (c == 'n') {
+        c = '\n';
+      } else if (c == 't') {
+        c = '\t';
+      }
+    }
+    result.push_back(c);
+  }
+  return result;
+}
+
+// Return false if the file cannot be read
+static bool Load(const char *name, Corpus *corpus) {
+  std::ifstream file(name);
+  if (!file) {
+    return false;
+  }
+  string line;
+  for (unsigned int number(1); std::getline(file, line); ++number) {
+    if (line.empty() || (line[0] == '#')) {
+      continue;
+    }
+    string::size_type tab(line.find('\t'));
+    if (tab == string::npos) {
+      SayError("%s:%s: missing tab") % name % number;
+      continue;
+    }
+    Entry entry;
+    entry.signature_.assign(line, 0, tab);
+    entry.escaped_.assign(line, tab + 1, string::npos);
+    entry.format_ = Unescape(entry.escaped_);
+    bool success;
+    Format trial(&success, entry.format_);
+    Apply(&trial, entry.signature_);
+    if (trial.error() != osformat::Error::kNone) {
+      SayError("%s:%s: %s") % name % number %
+        osformat::Error::c_str(trial.error());
+      continue;
+    }
+    entry.size_ = trial.size();
+    entry.plan_ = NULL;
+    corpus->push_back(entry);
+  }
+  return true;
+}
+
+static std::size_t Render(int mode, const Entry& entry, string *append,
+    FILE *file) {
+  switch (mode) {
+    case 0: {
+        Format format(entry.format_);
+        Apply(&format, entry.signature_);
+        return format.size();
+      }
+    case 1: {
+        Format format(*entry.plan_);
+        Apply(&format, entry.signature_);
+        return format.size();
+      }
+    case 2: {
+        append->clear();
+        Format format(append, *entry.plan_);
+        Apply(&format, entry.signature_);
+        return append->size();
+      }
+    case kSayMode: {
+        Say format(*entry.plan_);
+        Apply(&format, entry.signature_);
+        return format.count();
+      }
+    default: {
+        Format format(file, *entry.plan_, Special::Newline());
+        Apply(&format, entry.signature_);
+        return format.count();
+      }
+  }
+}
+
+static bool Slower(const Entry *a, const Entry *b) {
+  return (a->seconds_[0] > b->seconds_[0]);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    SayError("Usage: osformat-bench-corpus corpus_file [iterations]");
+    return 1;
+  }
+  unsigned long iterations((argc > 2) ?  // NOLINT(runtime/int)
+    std::strtoul(argv[2], NULL, 10) : 10000);
+  Corpus corpus;
+  if (!Load(argv[1], &corpus) || corpus.empty()) {
+    SayError("%s: no usable templates") % argv[1];
+    return 1;
+  }
+  FILE *file(std::fopen("/dev/null", "w"));
+  if (file == NULL) {
+    file = std::tmpfile();
+    if (file == NULL) {
+      SayError("cannot open a file for output");
+      return 1;
+    }
+  }
+  for (Corpus::iterator it(corpus.begin()); it != corpus.end(); ++it) {
+    it->plan_ = new Template(it->format_);
+  }
+  string append;
+  std::size_t sink(0);
+  Say("%s templates, %s iterations") % corpus.size() % iterations;
+  for (int mode(0); kModes[mode] != NULL; ++mode) {
+    // Say writes to stdout which is meanwhile redirected to file
+#ifdef HAVE_UNISTD_H
+    int saved_stdout(-1);
+    if (mode == kSayMode) {
+      std::fflush(stdout);
+      saved_stdout = dup(1);
+      if ((saved_stdout < 0) || (dup2(fileno(file), 1) < 0)) {
+        SayError("cannot redirect stdout");
+        return 1;
+      }
+    }
+#else
+    if (mode == kSayMode) {
+      continue;
+    }
+#endif
+    double seconds(0), bytes(0);
+    for (Corpus::iterator it(corpus.begin()); it != corpus.end(); ++it) {
+      std::clock_t start(std::clock());
+      for (unsigned long i(0); i != iterations; ++i) {  // NOLINT(runtime/int)
+        sink += Render(mode, *it, &append, file);
+      }
+      it->seconds_[mode] = static_cast<double>(std::clock() - start) /
+        CLOCKS_PER_SEC;
+      seconds += it->seconds_[mode];
+      bytes += static_cast<double>(it->size_) *
+        static_cast<double>(iterations);
+    }
+#ifdef HAVE_UNISTD_H
+    if (mode == kSayMode) {
+      std::fflush(stdout);
+      dup2(saved_stdout, 1);
+      close(saved_stdout);
+    }
+#endif
+    double messages(static_cast<double>(corpus.size()) *
+      static_cast<double>(iterations));
+    Say("%-9s %7.3f s %8.0f ns/message %8.0f k messages/s %6.1f MB/s") %
+      kModes[mode] % seconds % (seconds * 1e9 / messages) %
+      (messages / seconds / 1e3) % (bytes / seconds / 1e6);
+  }
+  std::vector<const Entry *> sorted;
+  for (Corpus::const_iterator it(corpus.begin()); it != corpus.end(); ++it) {
+    sorted.push_back(&*it);
+  }
+  std::sort(sorted.begin(), sorted.end(), Slower);
+  double median(sorted[sorted.size() / 2]->seconds_[0]);
+  Say("Slowest templates (Format; ns/message, factor to median):");
+  for (std::size_t i(0); (i != 5) && (i != sorted.size()); ++i) {
+    const Entry& entry(*sorted[i]);
+    Say("%8.0f %5.1fx %s %s") %
+      (entry.seconds_[0] * 1e9 / static_cast<double>(iterations)) %
+      ((median > 0) ? (entry.seconds_[0] / median) : 0.) %
+      entry.signature_ % entry.escaped_;
+  }
+  for (Corpus::iterator it(corpus.begin()); it != corpus.end(); ++it) {
+    delete it->plan_;
+  }
+  std::fclose(file);
+  return ((sink == 0) ? 1 : 0);
+}
@@ -0,0 +1,208 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+// Memory footprint of Format objects: For some formats, report the heap
+// bytes per pending object (all arguments still missing), per specifier,
+// and per finished object, as well as the resident set size per object in
+// a queue of many pending objects (constructed from a Template).
+// With C++11, the parts released by a Format object are kept in a pool of
+// the thread for reuse; so that they are counted, each heap measurement
+// runs in a new thread whose pool is still empty.
+// Each queue is built in a child process (if fork is available), since
+// memory freed by the previous queue would remain resident.
+// Usage: osformat-bench-footprint [millions_of_messages]
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/osformat.h"
+
+#include <cstdio>  // fflush
+#include <cstdlib>  // malloc, free, strtod, exit
+
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#include <thread>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <sys/wait.h>  // waitpid
+#include <unistd.h>  // fork, _exit
+#endif
+
+using std::string;
+
+using osformat::Format;
+using osformat::Say;
+using osformat::Template;
+
+// Count the heap bytes in use by replacing the global operator new.
+// The size is stored in front of each block (keeping the alignment).
+
+#if __cplusplus >= 201103L
+#define OSFORMAT_NOTHROW noexcept
+#else
+#define OSFORMAT_NOTHROW throw()
+#endif
+
+static std::size_t heap_in_use = 0;
+
+static const std::size_t kHeader = 16;
+
+static void *Allocate(std::size_t size) {
+  char *block(static_cast<char *>(std::malloc(size + kHeader)));
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<std::size_t *>(block) = size;
+  heap_in_use += size;
+  return block + kHeader;
+}
+
+static void Deallocate(void *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+  char *block(static_cast<char *>(pointer) - kHeader);
+  heap_in_use -= *reinterpret_cast<std::size_t *>(block);
+  std::free(block);
+}
+
+void *operator new(std::size_t size) {
+  return Allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+  return Allocate(size);
+}
+
+void operator delete(void *pointer) OSFORMAT_NOTHROW {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer) OSFORMAT_NOTHROW {
+  Deallocate(pointer);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void *pointer, std::size_t) OSFORMAT_NOTHROW {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) OSFORMAT_NOTHROW {
+  Deallocate(pointer);
+}
+#endif
+
+// Return the resident set size in kB from /proc (or 0 if unknown)
+static std::size_t ResidentKb() {
+  std::ifstream status("/proc/self/status");
+  string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return static_cast<std::size_t>(std::strtod(line.c_str() + 6, NULL));
+    }
+  }
+  return 0;
+}
+
+typedef std::vector<Format *> Queue;
+
+static void Clear(Queue *queue) {
+  for (Queue::iterator it(queue->begin()); it != queue->end(); ++it) {
+    delete *it;
+  }
+  Queue().swap(*queue);
+}
+
+// The heap bytes of one object (including the object itself) constructed
+// from format (or plan) after receiving the given number of arguments
+static void Bytes(const char *format, const Template *plan, int arguments,
+    std::size_t *bytes) {
+  std::size_t before(heap_in_use);
+  Format *object((plan == NULL) ? new Format(format) : new Format(*plan));
+  for (int i(0); i != arguments; ++i) {
+    *object % i;
+  }
+  *bytes = heap_in_use - before;
+  delete object;
+}
+
+static std::size_t FreshBytes(const char *format, const Template *plan,
+    int arguments) {
+  std::size_t bytes(0);
+#if __cplusplus >= 201103L
+  std::thread(Bytes, format, plan, arguments, &bytes).join();
+#else
+  Bytes(format, plan, arguments, &bytes);
+#endif
+  return bytes;
+}
+
+int main(int argc, char **argv) {
+  double millions((argc > 1) ? std::strtod(argv[1], NULL) : 0.1);
+  std::size_t messages(static_cast<std::size_t>(millions * 1000000));
+  static const struct {
+    const char *format;
+    int specifiers;
+  } kFormats[] = {
+    { "no specifier", 0 },
+    { "%s", 1 },
+    { "%s: %d", 2 },
+    { "%s %d %x %5s", 4 },
+    { "%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s", 16 },
+    { NULL, 0 }
+  };
+  Say("sizeof(Format) %s, sizeof(Template) %s, %s pending messages") %
+    sizeof(Format) % sizeof(Template) % messages;
+  Say("%-36s %8s %8s %8s %8s %8s") % "format" % "heap" % "/spec" %
+    "plan" % "finished" % "rss";
+  std::size_t base(FreshBytes("", NULL, 0));
+  for (int i(0); kFormats[i].format != NULL; ++i) {
+    const char *format(kFormats[i].format);
+    int specifiers(kFormats[i].specifiers);
+    Template plan(format);
+    std::size_t heap(FreshBytes(format, NULL, 0));
+    std::size_t per_specifier((specifiers == 0) ? 0 :
+      ((heap - base) / static_cast<std::size_t>(specifiers)));
+    std::size_t from_plan(FreshBytes(format, &plan, 0));
+    std::size_t finished(FreshBytes(format, NULL, specifiers));
+#ifdef HAVE_UNISTD_H
+    std::fflush(stdout);
+    pid_t child(fork());
+    if (child > 0) {
+      waitpid(child, NULL, 0);
+      continue;
+    }
+#endif
+    Queue queue;
+    queue.reserve(messages);
+    std::size_t rss_before(ResidentKb());
+    for (std::size_t j(0); j != messages; ++j) {
+      queue.push_back(new Format(plan));
+    }
+    std::size_t rss(ResidentKb());
+    rss = ((rss > rss_before) ? (rss - rss_before) : 0);
+    Say("%-36s %8s %8s %8s %8s %8.0f") % format % heap % per_specifier %
+      from_plan % finished %
+      ((messages == 0) ? 0. :
+        (static_cast<double>(rss) * 1024. / static_cast<double>(messages)));
+#ifdef HAVE_UNISTD_H
+    if (child == 0) {
+      std::fflush(stdout);
+      _exit(0);
+    }
+#endif
+    Clear(&queue);
+  }
+  return 0;
+}
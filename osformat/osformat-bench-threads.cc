@@ -0,0 +1,175 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+// Scaling with the number of threads: All threads format the same kind of
+// messages concurrently into a string, to stdout (redirected to /dev/null),
+// to one shared FILE, or to a thread-local ostream. For each target and
+// number of threads, the throughput per thread is reported relatively to
+// a single thread; a falling ratio indicates contention on shared state.
+// Usage: osformat-bench-threads [max_threads] [messages_per_thread]
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/osformat.h"
+
+#include <cstdio>  // FILE, fopen, fclose, fflush
+#include <cstdlib>  // strtoul
+
+#ifdef HAVE_UNISTD_H
+#include <fcntl.h>  // open
+#include <unistd.h>  // dup, dup2, close
+#endif
+
+#if __cplusplus >= 201103L
+#include <chrono>  // NOLINT(build/c++11)
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+#endif
+
+using osformat::Format;
+using osformat::Say;
+using osformat::SayError;
+
+#if __cplusplus >= 201103L
+
+enum Target {
+  kString,
+  kStdout,
+  kFile,
+  kOstream,
+  kTargets
+};
+
+static const char *const kTargetNames[] = {
+  "string",
+  "stdout",
+  "FILE",
+  "ostream"
+};
+
+static std::size_t Work(Target target, FILE *file,
+    unsigned long messages, unsigned int thread) {  // NOLINT(runtime/int)
+  std::size_t sink(0);
+  std::ostringstream os;
+  for (unsigned long i(0); i != messages; ++i) {  // NOLINT(runtime/int)
+    switch (target) {
+      case kString:
+        sink += (Format("thread %s: message %d %#x %.2f") % thread % i % i %
+          1.5).size();
+        break;
+      case kStdout:
+        sink += (Format(stdout, "thread %s: message %d %#x %.2f\n") % thread %
+          i % i % 1.5).count();
+        break;
+      case kFile:
+        sink += (Format(file, "thread %s: message %d %#x %.2f\n") % thread %
+          i % i % 1.5).count();
+        break;
+      default:
+        Format(os, "thread %s: message %d %#x %.2f\n") % thread % i % i % 1.5;
+        if ((i & 1023) == 1023) {
+          sink += static_cast<std::size_t>(os.tellp());
+          os.str(std::string());
+        }
+        break;
+    }
+  }
+  return sink;
+}
+
+// Return the messages per second of all threads
+static double Run(Target target, FILE *file, unsigned int threads,
+    unsigned long messages) {  // NOLINT(runtime/int)
+  std::vector<std::thread> workers;
+  std::vector<std::size_t> sinks(threads);
+  std::chrono::steady_clock::time_point start(
+    std::chrono::steady_clock::now());
+  for (unsigned int t(0); t != threads; ++t) {
+    workers.emplace_back([target, file, messages, t, &sinks]() {
+      sinks[t] = Work(target, file, messages, t);
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> seconds(std::chrono::steady_clock::now() -
+    start);
+  return (static_cast<double>(threads) * static_cast<double>(messages) /
+    seconds.count());
+}
+
+int main(int argc, char **argv) {
+  unsigned int max_threads((argc > 1) ?
+    static_cast<unsigned int>(std::strtoul(argv[1], NULL, 10)) :
+    std::thread::hardware_concurrency());
+  if (max_threads == 0) {
+    max_threads = 1;
+  }
+  unsigned long messages((argc > 2) ?  // NOLINT(runtime/int)
+    std::strtoul(argv[2], NULL, 10) : 20000);
+  FILE *file(std::fopen("/dev/null", "w"));
+  if (file == NULL) {
+    SayError("cannot open /dev/null");
+    return 1;
+  }
+  std::vector<unsigned int> counts;
+  for (unsigned int threads(1); threads < max_threads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(max_threads);
+  Say("%s messages per thread") % messages;
+  Say("%-8s %7s %12s %12s %8s") % "target" % "threads" % "k msg/s" %
+    "k msg/s/thr" % "scaling";
+  for (int t(0); t != kTargets; ++t) {
+    Target target(static_cast<Target>(t));
+#ifdef HAVE_UNISTD_H
+    // Keep the terminal clean, but still pass through stdio
+    int saved(-1);
+    if (target == kStdout) {
+      std::fflush(stdout);
+      saved = dup(1);
+      int null(open("/dev/null", O_WRONLY));
+      if ((saved < 0) || (null < 0) || (dup2(null, 1) < 0)) {
+        SayError("cannot redirect stdout");
+        return 1;
+      }
+      close(null);
+    }
+#endif
+    std::vector<double> rates;
+    for (unsigned int threads : counts) {
+      rates.push_back(Run(target, file, threads, messages));
+    }
+#ifdef HAVE_UNISTD_H
+    if (target == kStdout) {
+      std::fflush(stdout);
+      dup2(saved, 1);
+      close(saved);
+    }
+#endif
+    for (std::size_t i(0); i != counts.size(); ++i) {
+      double per_thread(rates[i] / counts[i]);
+      Say("%-8s %7s %12.1f %12.1f %7.2fx") % kTargetNames[t] % counts[i] %
+        (rates[i] / 1e3) % (per_thread / 1e3) % (per_thread / rates[0]);
+    }
+  }
+  std::fclose(file);
+  return 0;
+}
+
+#else  // __cplusplus < 201103L
+
+int main() {
+  SayError("osformat-bench-threads needs C++11");
+  return 0;
+}
+
+#endif  // __cplusplus >= 201103L
@@ -6,25 +6,90 @@
 //   Martin Väth <martin@mvath.de>
 
 #include "osformat/osformat.h"
+#include "osformat/builder.h"
+#include "osformat/catalog.h"
+#include "osformat/crc32c.h"
+#include "osformat/instrumentation.h"
+#include "osformat/isa.h"
+#include "osformat/log.h"
+#include "osformat/memo.h"
+#include "osformat/registry.h"
+#include "osformat/sampler.h"
+#include "osformat/static_format.h"
+#include "osformat/streams.h"
+
+#include <stdint.h>
+
+#include <cstdio>
 
 #include <iostream>
 #include <locale>
 #include <ostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 using std::cout;
 using std::locale;
 using std::ostringstream;
 using std::string;
 
+using osformat::Builder;
+using osformat::Crc32c;
 using osformat::Error;
 using osformat::Format;
+using osformat::Pipeline;
+using osformat::Instrumentation;
+using osformat::Isa;
 using osformat::Print;
 using osformat::PrintError;
 using osformat::Say;
+using osformat::Sampler;
 using osformat::SayError;
 using osformat::Special;
+using osformat::Template;
+
+enum Color {
+  kRed,
+  kGreen,
+  kBlue,
+  kBlack,
+  kGray = 10
+};
+
+enum Level {
+  kInfo,
+  kWarning
+};
+
+// A locale independent of the installed ones which groups by 3 digits
+class ThreeDigits : public std::numpunct<char> {
+ protected:
+  char do_thousands_sep() const {
+    return ',';
+  }
+
+  std::string do_grouping() const {
+    return "\3";
+  }
+};
+
+static const char *const kColorNames[] = { "red", "green", "blue" };
+static const char *const kLevelNames[] = { "info", NULL };
+
+OSFORMAT_ENUM_NAMES(Color, kColorNames)
+OSFORMAT_ENUM_NAMES_STRICT(Level, kLevelNames)
+
+static const uint64_t k10To16Minus1 =
+  static_cast<uint64_t>(99999999) * 100000000 + 99999999;
+
+static int evaluated = 0;
+
+static int Expensive() {
+  return ++evaluated;
+}
 
 int main() {
   string r = Format("Result %*d", Special::Newline()) % 2 % 1;
@@ -88,6 +153,442 @@ int main() {
   if (ok || (a.error() != Error::kTooEarlyArgument)) {
     return 1;
   }
+  Builder b(8);
+  Format(&b, "%s-%d") % "abc" % 12;
+  Format(&b, Special::Newline()) % string(20, 'x');
+  if ((!(Format(&b, "%s") % 'z').empty()) ||
+    (b.size() != 28) || (b.chunks() != 3) ||
+    (b.str() != "abc-12" + string(20, 'x') + "\nz")) {
+    return 1;
+  }
+  FILE *tmp(std::tmpfile());
+  if ((tmp == NULL) || !b.Output(fileno(tmp))) {
+    return 1;
+  }
+  std::rewind(tmp);
+  char buf[32];
+  if ((std::fread(buf, 1, sizeof(buf), tmp) != b.size()) ||
+    (string(buf, b.size()) != b.str())) {
+    return 1;
+  }
+  std::fclose(tmp);
+  bool out_of_range(false);
+  b.append(string("ab"), 2, 5);
+  try {
+    b.append(string("ab"), 3, 1);
+  } catch (const std::out_of_range&) {
+    out_of_range = true;
+  }
+  if (!out_of_range || (b.size() != 28)) {
+    return 1;
+  }
+  Crc32c crc;
+  b.set_checksum(&crc);
+  Format(&b, "%s%s") % "1234" % 56789;
+  if ((crc.value() != 0xE3069283) ||
+    (Crc32c::Compute(b.str().substr(b.size() - 9)) != 0xE3069283)) {
+    return 1;
+  }
+  Isa::Limit(Isa::kGeneric);
+  string dump;
+  Instrumentation::Dump(&dump);
+  if (Crc32c::Hardware() || (Crc32c::Compute("123456789") != 0xE3069283) ||
+    (Isa::Dispatched(Isa::kDecimal) != Isa::kGeneric) ||
+    ((Format("%s") % osformat::numbers(&k10To16Minus1, 1)).str() !=
+      "9999999999999999") ||
+    (dump.find("\nisa_used generic\nkernel_crc32c generic\n") ==
+      string::npos)) {
+    return 1;
+  }
+  Isa::Limit(Isa::kEnd);
+  if (Isa::Used() != Isa::Supported()) {
+    return 1;
+  }
+  FILE *source(std::tmpfile());
+  if ((source == NULL) || (std::fputs("hello world", source) < 0) ||
+    (std::fflush(source) != 0)) {
+    return 1;
+  }
+  int source_fd(fileno(source));
+  bool read_success;
+  Builder with_file;
+  Format(&with_file, "[%s|%s]") % osformat::file_range(source_fd, 6, 5) % 1;
+  tmp = std::tmpfile();
+  if ((tmp == NULL) || (with_file.chunks() != 3) ||
+    (with_file.str(&read_success) != "[world|1]") || !read_success ||
+    !with_file.Output(fileno(tmp)) ||
+    ((Format("%7s") % osformat::file_range(source_fd, 0, 5)).str() !=
+      "  hello") ||
+    (Format(&read_success, "%s") %
+      osformat::file_range(source_fd, 9, 5)).error() != Error::kReadFailed) {
+    return 1;
+  }
+  std::rewind(tmp);
+  if ((std::fread(buf, 1, sizeof(buf), tmp) != 9) ||
+    (string(buf, 9) != "[world|1]")) {
+    return 1;
+  }
+  std::fclose(tmp);
+  std::fclose(source);
+  Template plan("%2$s-%3$*1$d%%");
+  string plan_text;
+  Format(&plan_text, plan) % 3 % "a" % 4;
+  Format(&plan_text, plan, Special::Newline()) % -4 % 'b' % -5;
+  if ((plan.error() != Error::kNone) || (plan_text != "a-  4%b--5  %\n") ||
+    ((Format(plan) % 0 % "c" % 1).str() != "c-1%") ||
+    ((Format(Template("100%%")).str() != "100%"))) {
+    return 1;
+  }
+  Template sized("%s-%s");
+  std::size_t estimate(sized.estimate());
+  if ((Format(sized) % string(100, 'a') % 1).size() != 102 ||
+    (sized.estimate() < 102) || (estimate != 0) ||
+    ((Format(sized) % 'a' % 1).str() != "a-1") ||
+    (sized.estimate() < 99) || (sized.estimate() >= 102)) {
+    return 1;
+  }
+  Template *shortlived(new Template("%s:%s"));
+  Format outlives(*shortlived);
+  delete shortlived;
+  if ((outlives % 1 % 2).str() != "1:2") {
+    return 1;
+  }
+  bool success(true);
+  Template broken("%2$");
+  if ((broken.error() != Error::kMissingSpecifier) ||
+    (Format(&success, broken).error() != Error::kMissingSpecifier) ||
+    success) {
+    return 1;
+  }
+#if __cplusplus >= 201103L
+  osformat::Catalog catalog;
+  osformat::Catalog::Table *table(new osformat::Catalog::Table());
+  if ((table->Add("greet", "Hello %s") != Error::kNone) ||
+    (table->Add("bad", "%") != Error::kTrailingPercentage)) {
+    return 1;
+  }
+  catalog.Publish(table);
+  {
+    osformat::Catalog::Reader reader(catalog);
+    const Template *greet(reader.Find("greet"));
+    if ((greet == NULL) || (reader.Find("none") != NULL) ||
+      ((Format(*greet) % "you").str() != "Hello you")) {
+      return 1;
+    }
+  }
+  table = new osformat::Catalog::Table();
+  table->Add("greet", "Hallo %s");
+  catalog.Publish(table);
+  {
+    osformat::Catalog::Reader reader(catalog);
+    if ((Format(*reader.Find("greet")) % "du").str() != "Hallo du") {
+      return 1;
+    }
+  }
+  FILE *first(std::tmpfile()), *second(std::tmpfile());
+  if ((first == NULL) || (second == NULL)) {
+    return 1;
+  }
+  osformat::Log log(new osformat::Log::Config(1, first));
+  osformat::Log::Message(log, 1, "one %s") % 1;
+  osformat::Log::Message(log, 2, "two %s") % 2;
+  log.Configure(new osformat::Log::Config(2, second, true));
+  if (log.Enabled(3) || !log.Enabled(2) ||
+    (osformat::Log::Message(log, 2, "two %s") % 2).str() != "two 2\n") {
+    return 1;
+  }
+  log.Configure(NULL);
+  std::rewind(first);
+  if ((std::fread(buf, 1, sizeof(buf), first) != 6) ||
+    (string(buf, 6) != "one 1\n") || log.Enabled(0)) {
+    return 1;
+  }
+  std::fclose(first);
+  table = new osformat::Catalog::Table();
+  osformat::Catalog::Table::Entries entries;
+  for (int i(0); i != 300; ++i) {
+    entries.push_back(std::make_pair((Format("key%s") % (i % 200)).str(),
+      (Format("%s %%%s") % i % (((i % 100) == 99) ? "" : "s")).str()));
+  }
+  std::vector<Error::Code> errors(table->AddAll(entries, 3));
+  if ((errors.size() != 300) || (errors[1] != Error::kNone) ||
+    (errors[99] != Error::kTrailingPercentage) || (table->size() != 200) ||
+    ((Format(*table->Find("key5")) % 1).str() != "205 1")) {
+    return 1;
+  }
+  delete table;
+  // Long enough to not be stored within the string object
+  Format taken(Format("%s-%s") % "shared by all consumers" % 1);
+  const char *bytes(taken.c_str());
+  osformat::SharedText shared(taken.Take());
+  std::vector<osformat::SharedText> consumers(3, shared);
+  osformat::SharedText moved(std::move(consumers[0]));
+  if ((shared.str() != "shared by all consumers-1") ||
+    (shared.data() != bytes) || (consumers[2].c_str() != bytes) ||
+    (consumers[0].data() != bytes) || (moved.use_count() != 5) ||
+    !taken.empty() || !osformat::SharedText().empty()) {
+    return 1;
+  }
+  std::size_t registered(osformat::RegisterFormats());
+  string registry;
+  for (int i(0); i != 2; ++i) {
+    Format(&registry, OSFORMAT_REGISTERED("%s\t%s\n")) % i % "reg";
+  }
+  osformat::FormatRegistry::Dump(&registry);
+  if ((registered != osformat::FormatRegistry::size()) ||
+    (registry.find("0\treg\n1\treg\n") != 0) ||
+    (registry.find("osformat-test.cc:") == string::npos) ||
+    (registry.find("\t%s\\t%s\\n\n") == string::npos) ||
+    (osformat::FormatRegistry::Find(
+      static_cast<unsigned int>(osformat::FormatRegistry::size())) != NULL)) {
+    return 1;
+  }
+  Template queue("%s: %d %s");
+  osformat::Memo memo(queue, Special::Newline(), 1);
+  string queue_name("queue");
+  uint64_t memo_hits(Instrumentation::Get(Instrumentation::kMemoHits));
+  if ((memo.Render(queue_name, 0, 'x') != "queue: 0 x\n") ||
+    (memo.Render(queue_name, 0, 'x') != "queue: 0 x\n") ||
+    (memo.Render("queue", 0, 'x') != "queue: 0 x\n") ||
+    (memo.Render(queue_name, 0, 120) != "queue: 0 120\n") ||
+    (memo.Render(queue_name, 0, 120) != "queue: 0 120\n") ||
+    (memo.hits() != 2) || (memo.misses() != 3) ||
+    (Instrumentation::Get(Instrumentation::kMemoHits) != memo_hits + 2)) {
+    return 1;
+  }
+  memo.Render(queue_name, 0);
+  if ((memo.error() != Error::kTooFewArguments) ||
+    (memo.Render(queue_name, 0, 120) != "queue: 0 120\n") ||
+    (memo.misses() != 5) || (memo.error() != Error::kNone)) {
+    return 1;
+  }
+#endif  // __cplusplus >= 201103L
+  string muted;
+  success = false;
+  if (!(Format(&success, &muted, "%s %d", Special::Mute()) % "x" % 1 %
+      2).str().empty() || !success || !muted.empty() ||
+    !(Format(Special::Mute() | Special::Newline()).str().empty())) {
+    return 1;
+  }
+  uint64_t kept(Instrumentation::Get(Instrumentation::kSampledKept));
+  uint64_t dropped(Instrumentation::Get(Instrumentation::kSampledDropped));
+  Sampler all(1), few(1000);
+  Sampler::Seed(1);
+  int sampled(0);
+  for (int i(0); i != 1000; ++i) {
+    Format(&muted, "%s", all.Pick()) % 'a';
+    Format(&muted, "%s", few.Pick(Special::Newline())) % 'b';
+  }
+  for (string::size_type i(0); i != muted.size(); ++i) {
+    sampled += ((muted[i] == 'b') ? 1 : 0);
+  }
+  if ((muted.size() != 1000 + 2 * static_cast<string::size_type>(sampled)) ||
+    (sampled > 20) ||
+    (Instrumentation::Get(Instrumentation::kSampledKept) !=
+      kept + 1000 + static_cast<uint64_t>(sampled)) ||
+    (Instrumentation::Get(Instrumentation::kSampledDropped) !=
+      dropped + 1000 - static_cast<uint64_t>(sampled))) {
+    return 1;
+  }
+  if (((Format("%s %*d", Special::Mute()) % osformat::lazy(&Expensive) %
+      osformat::lazy(&Expensive) % 7).str() != "") ||
+    ((Format("%s %*d") % osformat::lazy(&Expensive) %
+      osformat::lazy(&Expensive) % 7).str() != "1  7") ||
+    (evaluated != 2) ||
+    ((Format(&success, "%s") % 1 % osformat::lazy(&Expensive)).error() !=
+      Error::kTooManyArguments) || (evaluated != 2)) {
+    return 1;
+  }
+#if __cplusplus >= 201103L
+  int counter(41);
+  if ((Format("%s") % osformat::lazy([counter]() mutable {
+      return ++counter;
+    })).str() != "42") {
+    return 1;
+  }
+#endif  // __cplusplus >= 201103L
+  if (((Format("%s %-6s|%:4d %x") % kRed % kGreen % kBlack %
+      kGray).str() != "red green |   3 a") ||
+    ((Format("%S") % kInfo).str() != "info") ||
+    (Format(&success, "%s") % kWarning).error() !=
+      Error::kUnknownEnumValue) {
+    return 1;
+  }
+  Template files("%1$d file%1$?{s||s} %2$?{disabled|enabled} %3$?{%%%||%}}");
+  if (((Format(files) % 0 % false % 0).str() != "0 files disabled %|") ||
+    ((Format(files) % 1 % true % 1).str() != "1 file enabled }") ||
+    ((Format(files) % 7 % 1 % -1).str() != "7 files enabled }") ||
+    ((Format("%?{a|b}%s") % 5U % 'c').str() != "bc") ||
+    ((Format("%?{r|g|b}") % kGreen).str() != "g") ||
+    ((Format(&success, "%?{a|b") % 0).error() != Error::kMalformedSelect) ||
+    ((Format(&success, "%?{a|b}") % "x").error() !=
+      Error::kSelectArgIsNotNumeric)) {
+    return 1;
+  }
+#if __cplusplus >= 201103L
+  // Without registered names, enums are accepted only with C++11
+  enum Answer { kNo, kYes };
+  if ((Format("%?{no|yes}") % kYes).str() != "yes") {
+    return 1;
+  }
+#endif  // __cplusplus >= 201103L
+  Template mixed("%s|%*d|%?{no|yes}|%S|%s");
+  if ((Format(mixed) % 'a' % 3 % 4 % 1 % std::string::npos %
+      kGreen).str() != "a|  4|yes|std::string::npos|green") {
+    return 1;
+  }
+#if __cplusplus >= 202002L
+  constexpr auto banner = osformat::static_format<
+    "%s v%d.%02d %#x|%:#8X|%-3s|% 4d|%+d|%S|%s|%d|%?{a|b}|%#o|%%",
+    osformat::StaticText("prog"), 1, 2, 255, 255, 'c', 3, 4U, true, false,
+    std::string::npos, -1, 8>();
+  static_assert(banner.size() == 68);
+  if (banner.str() != (Format("%s v%d.%02d %#x|%:#8X|%-3s|% 4d|%+d|%S|%s|%d|"
+      "%?{a|b}|%#o|%%") % "prog" % 1 % 2 % 255 % 255 % 'c' % 3 % 4U % true %
+      false % std::string::npos % -1 % 8).str()) {
+    return 1;
+  }
+#endif  // __cplusplus >= 202002L
+  Pipeline::Enable();
+  Pipeline::Force(16);
+  std::size_t buffered(Pipeline::buffered());
+  success = false;
+  Say(&success, "%s", Special::Flush()) % "pipe";
+  if (!success || !Pipeline::active() ||
+    (Pipeline::buffered() != buffered + 5)) {
+    return 1;
+  }
+  Say(&success, "%s") % "line which is longer than the buffer";
+  if (!success || (Pipeline::buffered() != 0) || !Pipeline::Disable() ||
+    Pipeline::active() || !Pipeline::Sync()) {
+    return 1;
+  }
+  Pipeline::Force(64);
+  osformat::Ordered::Enable();
+  Say(&success, "%s", Special::Flush()) % "ordered";
+  if (!success || !osformat::Ordered::active() ||
+    (Pipeline::buffered() != 8)) {
+    return 1;
+  }
+  SayError(&success, "%s") % "ordered";
+  if (!success || (Pipeline::buffered() != 0)) {
+    return 1;
+  }
+#if __cplusplus >= 201103L
+  // The requested flush is ignored, and stdout is flushed before stderr
+  Template memo_plan("%s %d");
+  osformat::Memo ordered_memo(memo_plan, Special::FlushNewline());
+  if (!ordered_memo.Output(stdout, "memo", 1) ||
+    (Pipeline::buffered() != 7)) {
+    return 1;
+  }
+  SayError(&success, "%s") % "ordered";
+  if (!success || (Pipeline::buffered() != 0)) {
+    return 1;
+  }
+#endif  // __cplusplus >= 201103L
+  if (!osformat::Ordered::Disable() || osformat::Ordered::active() ||
+    !Pipeline::Disable()) {
+    return 1;
+  }
+  const int ints[] = { 0, 7, -42, 12345, -99999999, 2147483647, 100000000 };
+  const unsigned long ulongs[] = { 0, 1, 1000000000, 4294967295UL,  // NOLINT
+    static_cast<unsigned long>(-2) };  // NOLINT(runtime/int)
+  std::vector<double> doubles;
+  doubles.push_back(1.5);
+  doubles.push_back(-0.25);
+  const char *bulk[] = { "%s", "%d", "%+d", "%08d", "%-6d", "%:+7d", "%x",
+    "%#X", "%#o", "%#:9x", "%_*5d", "%.2f", NULL };
+  for (int i(0); bulk[i] != NULL; ++i) {
+    const char *f(bulk[i]);
+    string expect_ints, expect_ulongs, expect_doubles;
+    for (std::size_t j(0); j != sizeof(ints) / sizeof(ints[0]); ++j) {
+      Format(&expect_ints, (j == 0) ? "%s" : ",%s") %
+        (Format(f) % ints[j]);
+    }
+    for (std::size_t j(0); j != sizeof(ulongs) / sizeof(ulongs[0]); ++j) {
+      Format(&expect_ulongs, (j == 0) ? "%s" : " %s") %
+        (Format(f) % ulongs[j]);
+    }
+    for (std::size_t j(0); j != doubles.size(); ++j) {
+      Format(&expect_doubles, (j == 0) ? "%s" : "; %s") %
+        (Format(f) % doubles[j]);
+    }
+    if (((Format(f) % osformat::numbers(ints, 7, ",")).str() !=
+        expect_ints) ||
+      ((Format(f) % osformat::numbers(ulongs, 5)).str() !=
+        expect_ulongs) ||
+      ((Format(f) % osformat::numbers(doubles, "; ")).str() !=
+        expect_doubles)) {
+      return 1;
+    }
+  }
+  if ((Format("[%s]") % osformat::numbers(ints, 0)).str() != "[]") {
+    return 1;
+  }
+#if __cplusplus >= 202002L
+  std::vector<int> mutable_ints(ints, ints + 3);
+  if (((Format("%d") % osformat::numbers(std::span<const int>(ints, 3),
+      ",")).str() != "0,7,-42") ||
+    ((Format("%+d") % osformat::numbers(std::span<int>(mutable_ints))).str() !=
+      "+0 +7 -42") ||
+    ((Format("[%s]") % osformat::numbers(std::span<int, 0>())).str() !=
+      "[]")) {
+    return 1;
+  }
+#endif  // __cplusplus >= 202002L
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef __int128 Int128;
+  __extension__ typedef unsigned __int128 UInt128;
+  // The first 5 formats are decimal and thus also compared for negatives
+  const char *same[] = { "%d", "%+d", "%05d", "%-5d|", "%:+5d", "%x",
+    "%#X", "%#o", "%#:8x", "%#:8o", NULL };
+  for (int i(0); same[i] != NULL; ++i) {
+    const char *f(same[i]);
+    if (((Format(f) % static_cast<Int128>(42)).str() !=
+        (Format(f) % static_cast<long>(42)).str()) ||  // NOLINT(runtime/int)
+      ((Format(f) % static_cast<UInt128>(255)).str() !=
+        (Format(f) % static_cast<unsigned long>(255)).str()) ||  // NOLINT
+      ((i < 5) && ((Format(f) % static_cast<Int128>(-42)).str() !=
+        (Format(f) % static_cast<long>(-42)).str()))) {  // NOLINT
+      return 1;
+    }
+  }
+  UInt128 max128(~static_cast<UInt128>(0));
+  if (((Format() % max128).str() !=
+      "340282366920938463463374607431768211455") ||
+    ((Format("%d") % static_cast<Int128>(max128 >> 1)).str() !=
+      "170141183460469231731687303715884105727") ||
+    ((Format("%d") % -static_cast<Int128>(max128 >> 1)).str() !=
+      "-170141183460469231731687303715884105727") ||
+    ((Format("%x") % (static_cast<UInt128>(1) << 64)).str() !=
+      "10000000000000000") ||
+    ((Format("%o") % max128).str() !=
+      "3777777777777777777777777777777777777777777") ||
+    ((Format("%*s|") % static_cast<Int128>(-3) % 7).str() != "7  |") ||
+    ((Format("%.*f") % static_cast<UInt128>(2) % .5).str() != "0.50") ||
+    ((Format("%/*d") % static_cast<Int128>('x') % 4 %
+      static_cast<Int128>(1)).str() != "xxx1")) {
+    return 1;
+  }
+#if __cplusplus >= 201103L
+  typedef unsigned long long ULongLong;  // NOLINT(runtime/int)
+#else  // __cplusplus < 201103L
+  typedef unsigned long ULongLong;  // NOLINT(runtime/int)
+#endif  // __cplusplus
+  locale grouped(locale::classic(), new ThreeDigits);
+  const char *grouped_same[] = { "%~#o", "%~#:12o", "%~#x", "%~d", NULL };
+  const ULongLong grouped_values[] = { 0777777, 07777777, 1000000, 0 };
+  for (int i(0); grouped_same[i] != NULL; ++i) {
+    for (int j(0); j != 4; ++j) {
+      const char *f(grouped_same[i]);
+      if ((Format(f) % grouped % static_cast<UInt128>(grouped_values[j])).str()
+        != (Format(f) % grouped % grouped_values[j]).str()) {
+        return 1;
+      }
+    }
+  }
+#endif  // __SIZEOF_INT128__
   ostringstream os;
   os << Say("Hello");
   cout << Print(Special::NewlineFlush()) % "FOO";
@@ -7,15 +7,23 @@
 
 #include "osformat/osformat.h"
 
+#include "osformat/builder.h"
+#include "osformat/digits.h"
+#include "osformat/streams.h"
+
+#include <stdint.h>  // uint64_t
+
 #include <cctype>  // isdigit
 
-#include <cstdio>  // fwrite, fflush, fprintf
+#include <cstdio>  // fflush, fprintf
 #include <cstdlib>  // abort, NULL
 
 #include <ios>
+#include <locale>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>  // std::make_pair
 #include <vector>
 
 using std::ios_base;
@@ -44,12 +52,17 @@ const char *Error::Description[] = {
   "missing specifier",
   "unknown specifier",
   "missing fill character",
+  "enum value has no registered name",
+  "malformed select %?{...}",
+  "argument for select is not numeric",
+  "reading a file failed",
 };
 
 const Special::Flags
   Special::kNone,
   Special::kNewline,
   Special::kFlush,
+  Special::kMute,
   Special::kAll;
 
 const Format::Defines::Flags
@@ -66,6 +79,7 @@ const Format::Extensions::Flags
   Format::Extensions::kIgnore,
   Format::Extensions::kPlusSpace,
   Format::Extensions::kStringNpos,
+  Format::Extensions::kSelect,
   Format::Extensions::kAll;
 
 // Declarations of some static helper functions:
@@ -77,6 +91,11 @@ static string::size_type EndNumber(const string& s, string::size_type start);
 
 inline static bool IsPositiveNumber(char c);
 
+#ifdef __SIZEOF_INT128__
+static string GroupDigits(const string& grouping, char separator,
+    const char *begin, const char *end);
+#endif  // __SIZEOF_INT128__
+
 
 // Definitions of some static helper functions:
 
@@ -111,9 +130,170 @@ inline static bool IsPositiveNumber(char c) {
   return (std::isdigit(c) && (c != '0'));
 }
 
+#ifdef __SIZEOF_INT128__
+
+// Insert thousands separators into the digits according to grouping
+static string GroupDigits(const string& grouping, char separator,
+    const char *begin, const char *end) {
+  // Collect the digits in reverse order
+  string reversed;
+  string::size_type group_index(0);
+  int in_group(0);
+  while (end != begin) {
+    char size(grouping[group_index]);
+    if ((size > 0) && (in_group == size)) {
+      reversed.append(1, separator);
+      in_group = 0;
+      if (group_index + 1 < grouping.size()) {
+        ++group_index;
+      }
+    }
+    reversed.append(1, *(--end));
+    ++in_group;
+  }
+  return string(reversed.rbegin(), reversed.rend());
+}
+
+#endif  // __SIZEOF_INT128__
+
+EnumTable::EnumTable(const char *const *names, std::size_t count,
+    Policy policy)
+  : names_(count), policy_(policy) {
+  for (std::size_t i(0); i != count; ++i) {
+    names_[i].name_ = names[i];
+    names_[i].length_ = ((names[i] == NULL) ? 0 :
+      string::traits_type::length(names[i]));
+  }
+}
+
+bool Format::WriteEnum(ostream *os, const EnumTable& table,
+    long value) {  // NOLINT(runtime/int)
+  std::size_t length;
+  const char *name(table.Name(value, &length));
+  if (name != NULL) {
+    WriteAdjusted(os, name, 0, length);
+    return true;
+  }
+  if (table.policy() == EnumTable::kStrict) {
+    Throw(Error::kUnknownEnumValue);
+    return false;
+  }
+  (*os) << value;
+  return true;
+}
+
+void Format::Manip::Reset(std::size_t index) {
+  ostream_.str(string());
+  ostream_.clear();
+  ostream_.flags(std::ios_base::skipws | std::ios_base::dec);
+  ostream_.width(0);
+  ostream_.precision(6);
+  ostream_.fill(' ');
+  // A new stream would use the current global locale
+  std::locale global;
+  if (ostream_.getloc() != global) {
+    ostream_.imbue(global);
+  }
+  extensions_ = Extensions::kNone;
+  need_ = Defines::kNone;
+  index_ = index;
+  select_first_ = select_count_ = selected_ = 0;
+}
+
+#if __cplusplus >= 201103L
+
+// Trivially destructible, so it can be read even after Pool was destructed
+static thread_local bool pool_destructed = false;
+
+class Format::Pool {
+ public:
+  static const std::size_t kMaxManips = 64;
+
+  // A Manip whose output was longer is not kept: Its buffer would remain
+  // allocated in the pool
+  static const std::streamoff kMaxLength = 256;
+
+  std::vector<Manip *> manips_;
+
+  ~Pool() {
+    pool_destructed = true;
+    for (std::vector<Manip *>::iterator it(manips_.begin());
+      it != manips_.end(); ++it) {
+      delete *it;
+    }
+  }
+
+  // Return NULL if the pool of this thread is already destructed
+  static Pool *Get() {
+    if (pool_destructed) {
+      return NULL;
+    }
+    static thread_local Pool pool;
+    return &pool;
+  }
+};
+
+const std::size_t Format::Pool::kMaxManips;
+const std::streamoff Format::Pool::kMaxLength;
+
+Format::Manip *Format::NewManip(std::size_t index) {
+  Pool *pool(Pool::Get());
+  if ((pool == NULL) || pool->manips_.empty()) {
+    return new Manip(index);
+  }
+  Manip *manip(pool->manips_.back());
+  pool->manips_.pop_back();
+  manip->Reset(index);
+  return manip;
+}
+
+void Format::DeleteManip(Manip *manip) {
+  Pool *pool(Pool::Get());
+  if ((pool == NULL) || (pool->manips_.size() >= Pool::kMaxManips) ||
+    (static_cast<std::streamoff>(manip->ostream_.rdbuf()->pubseekoff(0,
+      std::ios_base::cur, std::ios_base::out)) > Pool::kMaxLength)) {
+    delete manip;
+    return;
+  }
+  pool->manips_.push_back(manip);
+}
+
+#else  // __cplusplus < 201103L
+
+Format::Manip *Format::NewManip(std::size_t index) {
+  return new Manip(index);
+}
+
+void Format::DeleteManip(Manip *manip) {
+  delete manip;
+}
+
+#endif  // __cplusplus >= 201103L
+
 Format::Parse::~Parse() {
   for (FormatList::iterator it(format_.begin()); it != format_.end(); ++it) {
-    delete *it;
+    DeleteManip(*it);
+  }
+  if (estimate_ != NULL) {
+    estimate_->Release();
+  }
+}
+
+void Format::Parse::SetDirect() {
+  const Extensions::Flags dispatched(Extensions::kIgnore |
+    Extensions::kSelect | Extensions::kStringNpos);
+  direct_.assign(args_.size(), static_cast<Manip *>(NULL));
+  for (size_type i(0); i != args_.size(); ++i) {
+    const ArgsDefines& defines = args_[i];
+    if (defines.size() != 1) {
+      continue;
+    }
+    Manip *manip(defines[0].manip_);
+    if ((defines[0].set_these_ == Defines::kArg) &&
+      (manip->need_ == Defines::kNone) &&
+      ((manip->extensions_ & dispatched) == Extensions::kNone)) {
+      direct_[i] = manip;
+    }
   }
 }
 
@@ -149,11 +329,265 @@ void Format::Throw(Error::Code error) const {
   const_cast<Format *>(this)->parse_ = NULL;
 }
 
+void Format::WriteAdjusted(ostream *os, const char *text,
+    std::size_t prefix_len, std::size_t len) {
+  streamsize width(os->width(0));
+  if ((width <= 0) || (static_cast<std::size_t>(width) <= len)) {
+    os->write(text, static_cast<streamsize>(len));
+    return;
+  }
+  string padding(static_cast<std::size_t>(width) - len, os->fill());
+  ios_base::fmtflags adjust(os->flags() & ios_base::adjustfield);
+  if (adjust == ios_base::left) {
+    os->write(text, static_cast<streamsize>(len));
+    (*os) << padding;
+  } else if (adjust == ios_base::internal) {
+    os->write(text, static_cast<streamsize>(prefix_len));
+    (*os) << padding;
+    os->write(text + prefix_len, static_cast<streamsize>(len - prefix_len));
+  } else {
+    (*os) << padding;
+    os->write(text, static_cast<streamsize>(len));
+  }
+}
+
+#ifdef __SIZEOF_INT128__
+
+void Format::WriteInteger128(ostream *os, UInt128 value, bool is_signed) {
+  ios_base::fmtflags flags(os->flags());
+  ios_base::fmtflags base(flags & ios_base::basefield);
+  bool uppercase((flags & ios_base::uppercase) != 0);
+  bool showbase(((flags & ios_base::showbase) != 0) && (value != 0));
+  // 43 octal digits plus a prefix of at most 2 characters fit
+  char buffer[48];
+  char *end(buffer + sizeof(buffer));
+  char *begin(end);
+  // The prefix which is not grouped; only prefix_len characters of it
+  // count for internal adjustment
+  std::size_t prefix_len(0), ungrouped_len(0);
+  if (base == ios_base::hex) {
+    const char *digits(uppercase ? "0123456789ABCDEF" : "0123456789abcdef");
+    UInt128 rest(value);
+    do {
+      *(--begin) = digits[static_cast<std::size_t>(rest & 15)];
+      rest >>= 4;
+    } while (rest != 0);
+    if (showbase) {
+      *(--begin) = (uppercase ? 'X' : 'x');
+      *(--begin) = '0';
+      prefix_len = ungrouped_len = 2;
+    }
+  } else if (base == ios_base::oct) {
+    UInt128 rest(value);
+    do {
+      *(--begin) = static_cast<char>('0' + static_cast<int>(rest & 7));
+      rest >>= 3;
+    } while (rest != 0);
+    // The leading 0 does not count as prefix for internal adjustment
+    if (showbase) {
+      *(--begin) = '0';
+      ungrouped_len = 1;
+    }
+  } else {
+    // Convert in chunks of 19 decimal digits (fitting into 64 bits)
+    // so that only few 128 bit divisions are needed
+    static const UInt128 kChunk(
+      static_cast<UInt128>(1000000000U) * 1000000000U * 10U);
+    bool negative(is_signed && (static_cast<Int128>(value) < 0));
+    UInt128 rest(negative ? (~value + 1) : value);
+    while (rest >= kChunk) {
+      begin = Digits::DecimalBackward(begin,
+        static_cast<uint64_t>(rest % kChunk), true);
+      rest /= kChunk;
+    }
+    begin = Digits::DecimalBackward(begin, static_cast<uint64_t>(rest),
+      false);
+    if (negative) {
+      *(--begin) = '-';
+      prefix_len = ungrouped_len = 1;
+    } else if (is_signed && ((flags & ios_base::showpos) != 0)) {
+      *(--begin) = '+';
+      prefix_len = ungrouped_len = 1;
+    }
+  }
+  const std::numpunct<char>& punct(
+    std::use_facet<std::numpunct<char> >(os->getloc()));
+  string grouping(punct.grouping());
+  if (grouping.empty() || (grouping[0] <= 0)) {
+    WriteAdjusted(os, begin, prefix_len,
+      static_cast<std::size_t>(end - begin));
+    return;
+  }
+  string text(begin, ungrouped_len);
+  text.append(GroupDigits(grouping, punct.thousands_sep(),
+    begin + ungrouped_len, end));
+  WriteAdjusted(os, text.c_str(), prefix_len, text.size());
+}
+
+#endif  // __SIZEOF_INT128__
+
 void Format::Init(string *append, FILE *file, ostream *ostream, bool format) {
+  if (InitMuted()) {
+    return;
+  }
+  InitSimple(new Parse(true, append, file, ostream, NULL), format);
+}
+
+void Format::Init(string *append, FILE *file, ostream *ostream) {
+  if (InitMuted()) {
+    return;
+  }
+  InitFormat(new Parse(false, append, file, ostream, NULL));
+}
+
+void Format::Init(Builder *builder, bool format) {
+  if (InitMuted()) {
+    return;
+  }
+  InitSimple(new Parse(true, NULL, NULL, NULL, builder), format);
+}
+
+void Format::Init(Builder *builder) {
+  if (InitMuted()) {
+    return;
+  }
+  InitFormat(new Parse(false, NULL, NULL, NULL, builder));
+}
+
+void Format::Init(const Template& plan, string *append, FILE *file,
+    ostream *ostream, Builder *builder) {
+  if (InitMuted()) {
+    return;
+  }
+  const Format& compiled = plan.compiled_;
+  text_.assign(compiled.text_);
+  Parse *parse(new Parse(false, append, file, ostream, builder));
+  parse_ = parse;
+  parse->estimate_ = plan.estimate_;
+  plan.estimate_->Attach();
+  const Parse *source(compiled.parse_);
+  if (source == NULL) {
+    // The format had an error or needed no arguments: text_ is the result
+    if (compiled.error_ != Error::kNone) {
+      Throw(compiled.error_);
+      return;
+    }
+    InitialOutput();
+    return;
+  }
+  // Copy the parsed data; the references are mapped by the manip indices
+  parse->borders_ = source->borders_;
+  parse->selects_ = source->selects_;
+  Parse::FormatList& formats = parse->format_;
+  formats.reserve(source->format_.size());
+  for (Parse::FormatList::const_iterator it(source->format_.begin());
+    it != source->format_.end(); ++it) {
+    Manip *manip = NewManip(formats.size());
+    formats.push_back(manip);
+    manip->ostream_.copyfmt((*it)->ostream_);
+    manip->extensions_ = (*it)->extensions_;
+    manip->need_ = (*it)->need_;
+    manip->select_first_ = (*it)->select_first_;
+    manip->select_count_ = (*it)->select_count_;
+  }
+  Parse::ArgsList& args = parse->args_;
+  args.resize(source->args_.size());
+  for (Parse::ArgsList::size_type i(0); i != args.size(); ++i) {
+    const Parse::ArgsDefines& defines = source->args_[i];
+    args[i].reserve(defines.size());
+    for (Parse::ArgsDefines::const_iterator it(defines.begin());
+      it != defines.end(); ++it) {
+      args[i].push_back(References(it->set_these_,
+        formats[it->manip_->index_]));
+    }
+  }
+  parse->direct_.reserve(args.size());
+  for (Parse::FormatList::const_iterator it(source->direct_.begin());
+    it != source->direct_.end(); ++it) {
+    parse->direct_.push_back((*it == NULL) ? NULL : formats[(*it)->index_]);
+  }
+  parse->current_arg_ = args.begin();
+  error_ = Error::kTooFewArguments;
+  if (success_ != NULL) {
+    *success_ = false;
+  }
+}
+
+#if __cplusplus >= 201103L
+
+std::size_t Format::Estimate::value() const {
+  return value_.load(std::memory_order_relaxed);
+}
+
+void Format::Estimate::Learn(std::size_t size) {
+  std::size_t estimate(value_.load(std::memory_order_relaxed));
+  if (size != estimate) {
+    value_.store((size > estimate) ? size :
+      (estimate - ((estimate - size) >> 5)), std::memory_order_relaxed);
+  }
+}
+
+void Format::Estimate::Attach() {
+  references_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Format::Estimate::Release() {
+  if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+#else  // __cplusplus < 201103L
+
+std::size_t Format::Estimate::value() const {
+  return value_;
+}
+
+void Format::Estimate::Learn(std::size_t size) {
+  if (size > value_) {
+    value_ = size;
+  } else {
+    value_ -= ((value_ - size) >> 5);
+  }
+}
+
+void Format::Estimate::Attach() {
+  ++references_;
+}
+
+void Format::Estimate::Release() {
+  if (--references_ == 0) {
+    delete this;
+  }
+}
+
+#endif  // __cplusplus >= 201103L
+
+std::size_t Template::estimate() const {
+  return estimate_->value();
+}
+
+bool Format::InitMuted() {
   if (abort_) {
     success_ = NULL;
   }
-  Parse *parse = parse_ = new Parse(true, append, file, ostream);
+  if (!flags_.HaveBits(Special::kMute)) {
+    return false;
+  }
+  parse_ = NULL;
+  text_.clear();
+  error_ = Error::kNone;
+  if (success_ != NULL) {
+    *success_ = true;
+  }
+  return true;
+}
+
+void Format::InitSimple(Parse *parse, bool format) {
+  if (abort_) {
+    success_ = NULL;
+  }
+  parse_ = parse;
   if (!format) {
     InitialOutput();
     return;
@@ -165,11 +599,11 @@ void Format::Init(string *append, FILE *file, ostream *ostream, bool format) {
   }
 }
 
-void Format::Init(string *append, FILE *file, ostream *ostream) {
+void Format::InitFormat(Parse *parse) {
   if (abort_) {
     success_ = NULL;
   }
-  Parse *parse = parse_ = new Parse(false, append, file, ostream);
+  parse_ = parse;
   if (!ParseFormat()) {
     return;
   }
@@ -208,7 +642,7 @@ bool Format::ParseFormat() {
       break;
     }
     parse->borders_.push_back(start);
-    Manip *manip = new Manip();
+    Manip *manip = NewManip(parse->format_.size());
     parse->format_.push_back(manip);
     bool unknown_number(true);
     {
@@ -308,6 +742,12 @@ bool Format::ParseFormat() {
         case 's':
           got_specifier = true;
           break;
+        case '?':
+          got_specifier = true;
+          if (!ParseSelect(manip, &i)) {
+            return false;
+          }
+          break;
         case 'S':
           got_specifier = true;
           manip->ostream_.setf(ios_base::boolalpha | ios_base::showpoint);
@@ -424,6 +864,45 @@ bool Format::ParseFormat() {
       parse->SetIndirect(argnum++, it->set_these_, it->manip_);
     }
   }
+  parse->SetDirect();
+  return true;
+}
+
+// Parse the alternatives of %?{...|...}, removing the escaping % signs.
+// Assumes that index is at ?; at return it is at the closing }.
+// Return true if no error
+bool Format::ParseSelect(Manip *manip, string::size_type *index) {
+  string::size_type i(*index + 1);
+  if ((i == text_.size()) || (text_[i] != '{')) {
+    Throw(Error::kMalformedSelect);
+    return false;
+  }
+  Parse::BorderList& selects = parse_->selects_;
+  manip->extensions_ |= Extensions::kSelect;
+  manip->select_first_ = selects.size() / 2;
+  selects.push_back(++i);
+  for (;; ++i) {
+    if (i == text_.size()) {
+      Throw(Error::kMalformedSelect);
+      return false;
+    }
+    char c(text_[i]);
+    if (c == '%') {
+      text_.erase(i, 1);
+      if (i == text_.size()) {
+        Throw(Error::kMalformedSelect);
+        return false;
+      }
+    } else if (c == '|') {
+      selects.push_back(i);
+      selects.push_back(i + 1);
+    } else if (c == '}') {
+      selects.push_back(i);
+      break;
+    }
+  }
+  manip->select_count_ = selects.size() / 2 - manip->select_first_;
+  *index = i;
   return true;
 }
 
@@ -472,24 +951,97 @@ void Format::HandleArgumentNumber(Parse::size_type argnum,
   (*specified)[argnum] = true;
 }
 
+bool Format::DeferFileRange(const FileRange& arg) {
+  Parse *parse(parse_);
+  Builder *builder(parse->builder_);
+  if (parse->simple_ || (builder == NULL) || (builder->checksum() != NULL)) {
+    return false;
+  }
+  Manip *direct(parse->direct_[static_cast<Parse::size_type>(
+    parse->current_arg_ - parse->args_.begin())]);
+  // Padding or modifying the bytes would need them in memory
+  if ((direct == NULL) || (direct->ostream_.width() != 0) ||
+    ((direct->extensions_ & Extensions::kPlusSpace) != Extensions::kNone)) {
+    return false;
+  }
+  parse->files_.push_back(std::make_pair(direct, arg));
+  if (++(parse->current_arg_) == parse->args_.end()) {
+    FinishInsertingArgs();
+  }
+  return true;
+}
+
+bool Format::AppendFileRange(Builder *target, const Parse::FileList& files,
+    const Manip *manip) {
+  for (Parse::FileList::const_iterator it(files.begin());
+    it != files.end(); ++it) {
+    if (it->first == manip) {
+      const FileRange& range = it->second;
+      target->AppendFile(range.fd(), range.offset(), range.length());
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Format::StringStandard(ostream *os, const FileRange& arg) {
+  string contents;
+  if (!Builder::ReadFile(arg.fd(), arg.offset(), arg.length(), &contents)) {
+    Throw(Error::kReadFailed);
+    return false;
+  }
+  (*os) << contents;
+  return true;
+}
+
 void Format::FinishInsertingArgs() {
-  Parse& parse = *parse_;
-  string result;
-  Parse::FormatList& formats = parse.format_;
+  Builder *builder(parse_->builder_);
+  if (builder != NULL) {
+    // Render directly into the chunks; the newline is added by InitialOutput
+    RenderInto(builder);
+    text_.clear();
+  } else {
+    string result;
+    Estimate *estimate(parse_->estimate_);
+    if (estimate != NULL) {
+      result.reserve(estimate->value());
+    }
+    RenderInto(&result);
+    if (estimate != NULL) {
+      estimate->Learn(result.size());
+    }
+    text_.swap(result);
+  }
+  InitialOutput();
+}
+
+template<class T> void Format::RenderInto(T *target) const {
+  const Parse& parse = *parse_;
+  const Parse::FormatList& formats = parse.format_;
   Parse::FormatList::const_iterator format_iterator(formats.begin());
   Parse::BorderList::const_iterator it(parse.borders_.begin());
   string::size_type current_pos(0);
   for (; format_iterator!= formats.end();
     ++format_iterator, ++it, current_pos = *it, ++it) {
-    result.append(text_, current_pos,
+    target->append(text_, current_pos,
       static_cast<string::size_type>(*it - current_pos));
     Manip *manip(*format_iterator);
     Extensions::Flags extensions(manip->extensions_);
     if ((extensions & Extensions::kIgnore) != Extensions::kNone) {
       continue;
     }
+    if ((extensions & Extensions::kSelect) != Extensions::kNone) {
+      const string::size_type *alternative(
+        &(parse.selects_[2 * (manip->select_first_ + manip->selected_)]));
+      target->append(text_, alternative[0], alternative[1] - alternative[0]);
+      continue;
+    }
+    if (!parse.files_.empty() &&
+      AppendFileRange(target, parse.files_, manip)) {
+      continue;
+    }
     if ((extensions & Extensions::kPlusSpace) == Extensions::kNone) {
-      result.append(manip->ostream_.str());
+      target->append(manip->ostream_.str());
       continue;
     }
     string string_with_plus(manip->ostream_.str());
@@ -497,13 +1049,11 @@ void Format::FinishInsertingArgs() {
     if (plus != string::npos) {
       string_with_plus[plus] = ' ';
     }
-    result.append(string_with_plus);
+    target->append(string_with_plus);
   }
   if (current_pos != string::npos) {
-    result.append(text_, current_pos, string::npos);
+    target->append(text_, current_pos, string::npos);
   }
-  text_.assign(result);
-  InitialOutput();
 }
 
 void Format::OutputInternal(string *append) const {
@@ -515,24 +1065,13 @@ void Format::OutputInternal(string *append) const {
 }
 
 void Format::OutputInternal(FILE *file) const {
-  bool success(true);
+  Error::Code error;
   error_ = Error::kNone;
-  count_ = 0;
-  if (!text_.empty()) {
-    count_ = std::fwrite(text_.c_str(), sizeof(char), text_.size(), file);
-    if (count_ < text_.size()) {
-      Throw(Error::kWriteFailed);
-      success = false;
-    }
-    if (success && flush()) {
-      if (std::fflush(file) != 0) {
-        Throw(Error::kFlushFailed);
-        success = false;
-      }
-    }
-  }
-  if (success_ != NULL) {
-    *success_ = success;
+  count_ = Ordered::Write(file, text_, flush(), &error);
+  if (error != Error::kNone) {
+    Throw(error);
+  } else if (success_ != NULL) {
+    *success_ = true;
   }
 }
 
@@ -558,12 +1097,24 @@ void Format::OutputInternal(ostream& ostream) const {
   }
 }
 
+void Format::OutputInternal(Builder *builder) const {
+  builder->append(text_);
+  error_ = Error::kNone;
+  if (success_ != NULL) {
+    *success_ = true;
+  }
+}
+
 void Format::InitialOutput() {
   if (flags_.HaveBits(Special::kNewline)) {
     text_.append(1, '\n');
   }
   if (parse_->append_) {
     OutputInternal(parse_->append_);
+  } else if (parse_->builder_) {
+    // The Builder is the only place where the text is kept
+    OutputInternal(parse_->builder_);
+    text_.clear();
   } else if (parse_->file_) {
     OutputInternal(parse_->file_);
   } else if (parse_->ostream_) {
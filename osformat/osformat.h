@@ -8,6 +8,8 @@
 #ifndef OSFORMAT_OSFORMAT_H_
 #define OSFORMAT_OSFORMAT_H_ 1
 
+#include <stdint.h>  // uint64_t
+
 #include <cassert>  // assert
 #include <cstdio>  // size_t, FILE
 
@@ -18,10 +20,17 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>  // std::pair, std::move
 #include <vector>
 
 #if __cplusplus >= 201103L
-#include <utility>  // std::move
+#include <atomic>
+#include <memory>  // std::shared_ptr
+#include <type_traits>  // std::is_enum
+#endif
+
+#if __cplusplus >= 202002L
+#include <span>
 #endif
 
 // We must include all the iostream and fstream stuff:
@@ -32,6 +41,9 @@
 
 namespace osformat {
 
+class Builder;
+class Template;
+
 class Error {
  public:
   enum Code {
@@ -52,6 +64,10 @@ class Error {
     kMissingSpecifier,
     kUnknownSpecifier,
     kMissingFillCharacter,
+    kUnknownEnumValue,
+    kMalformedSelect,
+    kSelectArgIsNotNumeric,
+    kReadFailed,
     kEnd
   };
 
@@ -102,7 +118,8 @@ class Special {
     kNone         = 0,
     kNewline      = 1 << 1,
     kFlush        = 1 << 2,
-    kAll          = (1 << 3) - 1;
+    kMute         = 1 << 3,  // Do nothing at all (e.g. for sampling)
+    kAll          = (1 << 4) - 1;
 
   Special()
     : flags_(kNone) {
@@ -138,6 +155,10 @@ class Special {
     return New(kFlush | kNewline);
   }
 
+  static Special Mute() {
+    return New(kMute);
+  }
+
   // Assignments an bit operations can be fully allowed.
   // This is complete overkill, but who knows what the user might want to do...
 
@@ -247,8 +268,253 @@ class Special {
 };
 
 
+// A table of names for the values 0, 1, 2, ... of an enum type.
+// It is usually not used directly but registered for the enum type by
+//
+//   static const char *const kColorNames[] = { "red", "green", "blue" };
+//   OSFORMAT_ENUM_NAMES(Color, kColorNames)
+//
+// (in the global namespace). Then the names are output for such arguments,
+// bypassing operator<<. Values without a name (also NULL entries) are
+// output as numbers, or with OSFORMAT_ENUM_NAMES_STRICT they are an error.
+
+class EnumTable {
+ public:
+  enum Policy {
+    kNumericFallback,
+    kStrict
+  };
+
+  EnumTable(const char *const *names, std::size_t count, Policy policy);
+
+  // Return NULL if value has no name
+  const char *Name(long value, std::size_t *length) const {  // NOLINT
+    if ((value < 0) || (static_cast<unsigned long>(value) >=  // NOLINT
+        names_.size())) {
+      return NULL;
+    }
+    const Entry& entry = names_[static_cast<std::size_t>(value)];
+    *length = entry.length_;
+    return entry.name_;
+  }
+
+  Policy policy() const {
+    return policy_;
+  }
+
+ private:
+  class Entry {
+   public:
+    const char *name_;
+    std::size_t length_;
+  };
+
+  std::vector<Entry> names_;
+  Policy policy_;
+};
+
+// Specialized by OSFORMAT_ENUM_NAMES for registered enum types
+template<class T> class EnumNames {
+ public:
+#if __cplusplus >= 201103L
+  constexpr
+#endif
+  static const bool kRegistered = false;
+};
+
+#define OSFORMAT_ENUM_NAMES_POLICY(type, names, policy) \
+  namespace osformat { \
+  template<> class EnumNames<type> { \
+   public: \
+    static const bool kRegistered = true; \
+    static const EnumTable& Table() { \
+      static const EnumTable table((names), \
+        sizeof(names) / sizeof((names)[0]), (policy)); \
+      return table; \
+    } \
+  }; \
+  }
+
+#define OSFORMAT_ENUM_NAMES(type, names) \
+  OSFORMAT_ENUM_NAMES_POLICY(type, names, \
+    osformat::EnumTable::kNumericFallback)
+
+#define OSFORMAT_ENUM_NAMES_STRICT(type, names) \
+  OSFORMAT_ENUM_NAMES_POLICY(type, names, osformat::EnumTable::kStrict)
+
+// An argument wrapper for outputting an array of numbers, separated by
+// separator. The width, fill and adjustment of the specifier apply to each
+// element; integers are converted in bulk.
+// Objects are usually created with osformat::numbers(); the referenced data
+// (and separator) must be valid until the argument is processed.
+
+template<class T> class NumberList {
+ public:
+  NumberList(const T *data, std::size_t size, const char *separator)
+    : data_(data), size_(size), separator_(separator) {
+  }
+
+  const T *data() const {
+    return data_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  const char *separator() const {
+    return separator_;
+  }
+
+ private:
+  const T *data_;
+  std::size_t size_;
+  const char *separator_;
+};
+
+template<class T> NumberList<T> numbers(const T *data, std::size_t size,
+    const char *separator = " ") {
+  return NumberList<T>(data, size, separator);
+}
+
+template<class T> NumberList<T> numbers(const std::vector<T>& v,
+    const char *separator = " ") {
+  return NumberList<T>((v.empty() ? NULL : &(v[0])), v.size(), separator);
+}
+
+#if __cplusplus >= 202002L
+template<class T, std::size_t N> NumberList<T> numbers(std::span<T, N> s,
+    const char *separator = " ") {
+  return NumberList<T>(s.data(), s.size(), separator);
+}
+
+template<class T, std::size_t N> NumberList<T> numbers(
+    std::span<const T, N> s, const char *separator = " ") {
+  return NumberList<T>(s.data(), s.size(), separator);
+}
+#endif
+
+// An argument wrapper for a value which is expensive to compute:
+// The callable is invoked (without arguments) only when the argument is
+// actually converted, i.e. not for a muted object (e.g. dropped by a
+// Sampler) or after an error; its result is then used as the argument.
+// Objects are usually created with osformat::lazy(); references captured by
+// the callable must be valid until the argument is processed.
+
+template<class F> class Lazy {
+ public:
+  explicit Lazy(const F& function)
+    : function_(function) {
+  }
+
+  // The callable may change its state (e.g. a mutable lambda)
+  F& function() const {
+    return function_;
+  }
+
+ private:
+  mutable F function_;
+};
+
+template<class F> Lazy<F> lazy(const F& function) {
+  return Lazy<F>(function);
+}
+
+// An argument wrapper for length bytes of the file fd, starting at offset.
+// If the output is a Builder and the argument is output unmodified (e.g.
+// by %s), the file is referenced by the Builder, so that its bytes are
+// copied by the kernel when the Builder is written to a file descriptor.
+// Otherwise, the bytes are read immediately and output like a string.
+// Objects are usually created with osformat::file_range().
+
+class FileRange {
+ public:
+  FileRange(int fd, uint64_t offset, std::size_t length)
+    : fd_(fd), offset_(offset), length_(length) {
+  }
+
+  int fd() const {
+    return fd_;
+  }
+
+  uint64_t offset() const {
+    return offset_;
+  }
+
+  std::size_t length() const {
+    return length_;
+  }
+
+ private:
+  int fd_;
+  uint64_t offset_;
+  std::size_t length_;
+};
+
+inline FileRange file_range(int fd, uint64_t offset, std::size_t length) {
+  return FileRange(fd, offset, length);
+}
+
+#if __cplusplus >= 201103L
+
+// An immutable, reference-counted result of a Format (see Format::Take()):
+// Copies share the same bytes, which are freed with the last copy, so the
+// result can be passed to several queues or threads without copying it.
+
+class SharedText {
+ public:
+  SharedText()
+    : text_(std::make_shared<const std::string>()) {
+  }
+
+  explicit SharedText(std::string&& text)
+    : text_(std::make_shared<const std::string>(std::move(text))) {
+  }
+
+  // A move only copies, so that no object is left without bytes
+  SharedText(const SharedText&) = default;
+  SharedText& operator=(const SharedText&) = default;
+
+  const std::string& str() const {
+    return *text_;
+  }
+
+  const char *c_str() const {
+    return text_->c_str();
+  }
+
+  const char *data() const {
+    return text_->data();
+  }
+
+  std::string::size_type size() const {
+    return text_->size();
+  }
+
+  bool empty() const {
+    return text_->empty();
+  }
+
+  // The number of objects sharing the bytes
+  long use_count() const {  // NOLINT(runtime/int)
+    return text_.use_count();
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const SharedText& t) {
+    return (os << *(t.text_));
+  }
+
+ private:
+  std::shared_ptr<const std::string> text_;
+};
+
+#endif  // __cplusplus >= 201103L
+
+
 class Format {
  private:
+  friend class Template;
+
   class Defines {
    public:
     typedef unsigned char Flags;
@@ -281,7 +547,8 @@ class Format {
       kIgnore     = 1 << 1,  // Ignore the whole argument
       kPlusSpace  = 1 << 2,  // + -> ' '
       kStringNpos = 1 << 3,  // std::string::npos translation
-      kAll        = (1 << 4) - 1;
+      kSelect     = 1 << 4,  // %?{...|...}: choose a literal alternative
+      kAll        = (1 << 5) - 1;
 
    private:
     Extensions() {}  // Do not instantiate this purely static class by accident
@@ -292,9 +559,54 @@ class Format {
     std::ostringstream ostream_;
     Extensions::Flags extensions_;
     Defines::Flags need_;
-    Manip()
-      : extensions_(Extensions::kNone), need_(Defines::kNone) {
+    std::size_t index_;  // The position in Parse::format_
+    // For kSelect: The alternatives in Parse::selects_ and the chosen one
+    std::size_t select_first_, select_count_, selected_;
+    explicit Manip(std::size_t index)
+      : extensions_(Extensions::kNone), need_(Defines::kNone), index_(index),
+      select_first_(0), select_count_(0), selected_(0) {
     }
+
+    // Make a recycled object equivalent to a newly constructed one
+    void Reset(std::size_t index);
+  };
+
+  // Recycling of Manip objects (so that their ostringstream need not be
+  // constructed anew): With C++11, each thread keeps a few released ones
+  class Pool;
+
+  static Manip *NewManip(std::size_t index);
+
+  static void DeleteManip(Manip *manip);
+
+  // A running estimate of a high percentile of the result lengths of a
+  // Template: It follows a longer result at once and decays slowly to
+  // shorter ones. This is only a hint, so concurrent updates may get lost.
+  // It is shared by reference counting with the objects constructed from
+  // the Template, so these can report their result after its destruction
+  // (without C++11, the counter is not atomic).
+  class Estimate {
+   public:
+    Estimate() : value_(0), references_(1) {
+    }
+
+    std::size_t value() const;
+
+    void Learn(std::size_t size);
+
+    void Attach();
+
+    // Drop a reference; the last one deletes the object
+    void Release();
+
+   private:
+#if __cplusplus >= 201103L
+    std::atomic<std::size_t> value_;
+    std::atomic<unsigned int> references_;
+#else  // __cplusplus < 201103L
+    std::size_t value_;
+    unsigned int references_;
+#endif  // __cplusplus
   };
 
   class References {
@@ -320,6 +632,9 @@ class Format {
     typedef std::vector<std::string::size_type> BorderList;
     BorderList borders_;
 
+    // The (begin, end) indices of all select alternatives in the format
+    BorderList selects_;
+
     // The indirect references to format_ in the order of the arguments
     typedef std::vector<References> ArgsDefines;
     typedef std::vector<ArgsDefines> ArgsList;
@@ -329,21 +644,37 @@ class Format {
     // The next argument parsed by the % operator
     ArgsList::const_iterator current_arg_;
 
+    // For each argument the Manip if the argument is just output by this
+    // Manip (or NULL): Then the % operator can skip the generic dispatch
+    FormatList direct_;
+
     // Is the whole stuff only considered to be an implicit %s?
     bool simple_;
 
     std::string *append_;
     FILE *file_;
     std::ostream *ostream_;
+    Builder *builder_;
+
+    // The estimate of the Template used (if any) for the result length
+    Estimate *estimate_;
+
+    // The FileRange arguments which are referenced by builder_
+    typedef std::vector<std::pair<const Manip *, FileRange> > FileList;
+    FileList files_;
 
     Parse(bool simple, std::string *append, FILE *file,
-        std::ostream *ostream)
-      : simple_(simple), append_(append), file_(file), ostream_(ostream) {
+        std::ostream *ostream, Builder *builder)
+      : simple_(simple), append_(append), file_(file), ostream_(ostream),
+      builder_(builder), estimate_(NULL) {
     }
 
     ~Parse();
 
     void SetIndirect(size_type argnum, Defines::Flags set_these, Manip *manip);
+
+    // Calculate direct_ from args_
+    void SetDirect();
   };
 
   bool abort_;
@@ -363,8 +694,25 @@ class Format {
 
   void Init(std::string *append, FILE *file, std::ostream *ostream);
 
+  void Init(Builder *builder, bool format);
+
+  void Init(Builder *builder);
+
+  void Init(const Template& plan, std::string *append, FILE *file,
+    std::ostream *ostream, Builder *builder);
+
+  // If Special::kMute is set, enter the finished state without any output
+  // (so that all further % are ignored) and return true
+  bool InitMuted();
+
+  void InitSimple(Parse *parse, bool format);
+
+  void InitFormat(Parse *parse);
+
   bool ParseFormat();
 
+  bool ParseSelect(Manip *manip, std::string::size_type *index);
+
   bool SetArg(Defines::Flags set_these, Parse::ArgsDefines *define_queue,
     SpecifiedList *specified, Manip *manip, std::string::size_type *index);
 
@@ -392,12 +740,39 @@ class Format {
 
   void FinishInsertingArgs();
 
+  // Let the Builder reference arg if possible (then the argument is done)
+  bool DeferFileRange(const FileRange& arg);
+
+  // Append the FileRange of manip (if in files) to the target;
+  // return false if manip has none
+  static bool AppendFileRange(Builder *target, const Parse::FileList& files,
+    const Manip *manip);
+
+  // Only the Builder can reference files
+  static bool AppendFileRange(std::string *, const Parse::FileList&,
+      const Manip *) {
+    return false;
+  }
+
+  // Handle an argument when parse_ is NULL
+  Format& SuperfluousArgument() {
+    if ((error_ == Error::kNone) && !flags_.HaveBits(Special::kMute)) {
+      Throw(Error::kTooManyArguments);
+    }
+    return *this;
+  }
+
+  // Append the result of the parsed format to the target
+  template<class T> void RenderInto(T *target) const;
+
   void OutputInternal(std::string *append) const;
 
   void OutputInternal(FILE *file) const;
 
   void OutputInternal(std::ostream& ostream) const;
 
+  void OutputInternal(Builder *builder) const;
+
   void InitialOutput();
 
   void Check() const {
@@ -408,6 +783,70 @@ class Format {
 
   void Throw(Error::Code error) const;
 
+  // Write text of length len to os, padding according to width, fill and
+  // adjustfield of os. For internal adjustment, padding is inserted after
+  // the first prefix_len characters (e.g. a sign or a base prefix).
+  static void WriteAdjusted(std::ostream *os, const char *text,
+    std::size_t prefix_len, std::size_t len);
+
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef __int128 Int128;
+  __extension__ typedef unsigned __int128 UInt128;
+
+  // Output the value (the bits of an Int128 if is_signed) honouring the
+  // basefield, showbase, showpos, uppercase and grouping of os
+  static void WriteInteger128(std::ostream *os, UInt128 value,
+    bool is_signed);
+#endif  // __SIZEOF_INT128__
+
+  // Output the size numbers starting at data, separated by separator.
+  // The width of os is applied to each number.
+  template<class T> static void WriteNumbers(std::ostream *os, const T *data,
+      std::size_t size, const char *separator) {
+    std::streamsize width(os->width());
+    for (std::size_t i(0); i != size; ++i) {
+      if (i != 0) {
+        (*os) << separator;
+      }
+      os->width(width);
+      (*os) << data[i];
+    }
+    os->width(0);
+  }
+
+  // For integers, the conversion is done in bulk (see numbers.cc)
+  static void WriteNumbers(std::ostream *os,
+    const short *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os,
+    const unsigned short *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os, const int *data,
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os, const unsigned int *data,
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os,
+    const long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os,
+    const unsigned long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+
+#if __cplusplus >= 201103L
+  static void WriteNumbers(std::ostream *os,
+    const long long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+
+  static void WriteNumbers(std::ostream *os,
+    const unsigned long long *data,  // NOLINT(runtime/int)
+    std::size_t size, const char *separator);
+#endif
+
   // This is the default template to catch errors at runtime:
   template<class T> bool SetLocale(std::ostream *, const T&) {
     Throw(Error::kLocaleArgIsNoLocale);
@@ -524,6 +963,18 @@ class Format {
   }
 #endif  // __cplusplus
 
+#ifdef __SIZEOF_INT128__
+  bool SetPrecision(std::ostream *os, Int128 arg) {
+    os->precision(static_cast<std::streamsize>(arg));
+    return true;
+  }
+
+  bool SetPrecision(std::ostream *os, UInt128 arg) {
+    os->precision(static_cast<std::streamsize>(arg));
+    return true;
+  }
+#endif  // __SIZEOF_INT128__
+
   // This is the default template to catch errors at runtime:
   template<class T> bool SetWidth(std::ostream *, const T&) {
     Throw(Error::kWidthArgIsNotNumeric);
@@ -674,6 +1125,22 @@ class Format {
   }
 #endif  // __cplusplus
 
+#ifdef __SIZEOF_INT128__
+  bool SetWidth(std::ostream *os, Int128 arg) {
+    if (arg < 0) {
+      arg = -arg;
+      os->setf(std::ios_base::left, std::ios_base::adjustfield);
+    }
+    os->width(static_cast<std::streamsize>(arg));
+    return true;
+  }
+
+  bool SetWidth(std::ostream *os, UInt128 arg) {
+    os->width(static_cast<std::streamsize>(arg));
+    return true;
+  }
+#endif  // __SIZEOF_INT128__
+
   // This is the default template to catch errors at runtime:
   template<class T> bool SetFill(std::ostream *, const T&) {
     Throw(Error::kFillArgIsNotChar);
@@ -775,12 +1242,150 @@ class Format {
   }
 #endif  // __cplusplus
 
+#ifdef __SIZEOF_INT128__
+  bool SetFill(std::ostream *os, Int128 arg) {
+    os->fill(static_cast<char>(arg));
+    return true;
+  }
+
+  bool SetFill(std::ostream *os, UInt128 arg) {
+    os->fill(static_cast<char>(arg));
+    return true;
+  }
+#endif  // __SIZEOF_INT128__
+
+  // Choose the alternative number index of a select (or the last one)
+  static void Select(Manip *manip, std::size_t index) {
+    manip->selected_ = ((index < manip->select_count_) ? index :
+      (manip->select_count_ - 1));
+  }
+
+  // This is the default template to catch errors at runtime, except that
+  // enums are converted (without C++11, only those with registered names)
+  template<class T> bool SetSelect(Manip *manip, const T& arg) {
+#if __cplusplus >= 201103L
+    return SetSelectEnum(manip, arg, EnumTag<std::is_enum<T>::value>());
+#else  // __cplusplus < 201103L
+    return SetSelectEnum(manip, arg, EnumTag<EnumNames<T>::kRegistered>());
+#endif  // __cplusplus
+  }
+
+  // Negative numbers choose the last alternative
+  bool SetSelect(Manip *manip, bool arg) {
+    Select(manip, (arg ? 1 : 0));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip, char arg) {
+    return SetSelect(manip, static_cast<int>(arg));
+  }
+
+  bool SetSelect(Manip *manip, signed char arg) {
+    return SetSelect(manip, static_cast<int>(arg));
+  }
+
+  bool SetSelect(Manip *manip, unsigned char arg) {
+    return SetSelect(manip, static_cast<unsigned int>(arg));
+  }
+
+  bool SetSelect(Manip *manip, short arg) {  // NOLINT(runtime/int)
+    return SetSelect(manip, static_cast<int>(arg));
+  }
+
+  bool SetSelect(Manip *manip, unsigned short arg) {  // NOLINT(runtime/int)
+    return SetSelect(manip, static_cast<unsigned int>(arg));
+  }
+
+  bool SetSelect(Manip *manip, int arg) {
+    Select(manip, ((arg < 0) ? manip->select_count_ :
+      static_cast<std::size_t>(arg)));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip, unsigned int arg) {
+    Select(manip, static_cast<std::size_t>(arg));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip, long arg) {  // NOLINT(runtime/int)
+    Select(manip, ((arg < 0) ? manip->select_count_ :
+      static_cast<std::size_t>(arg)));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip, unsigned long arg) {  // NOLINT(runtime/int)
+    Select(manip, static_cast<std::size_t>(arg));
+    return true;
+  }
+
+#if __cplusplus >= 201103L
+  bool SetSelect(Manip *manip, long long arg) {  // NOLINT(runtime/int)
+    Select(manip, ((arg < 0) ? manip->select_count_ :
+      static_cast<std::size_t>(arg)));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip,
+      unsigned long long arg) {  // NOLINT(runtime/int)
+    Select(manip, static_cast<std::size_t>(arg));
+    return true;
+  }
+#endif  // __cplusplus
+
+#ifdef __SIZEOF_INT128__
+  bool SetSelect(Manip *manip, Int128 arg) {
+    Select(manip, ((arg < 0) ? manip->select_count_ :
+      static_cast<std::size_t>((arg < manip->select_count_) ? arg :
+      manip->select_count_)));
+    return true;
+  }
+
+  bool SetSelect(Manip *manip, UInt128 arg) {
+    Select(manip, static_cast<std::size_t>((arg < manip->select_count_) ?
+      arg : manip->select_count_));
+    return true;
+  }
+#endif  // __SIZEOF_INT128__
+
+  template<bool kRegistered> class EnumTag {
+  };
+
+  template<class T> bool SetSelectEnum(Manip *, const T&, EnumTag<false>) {
+    Throw(Error::kSelectArgIsNotNumeric);
+    return false;
+  }
+
+  template<class T> bool SetSelectEnum(Manip *manip, const T& arg,
+      EnumTag<true>) {
+#if __cplusplus >= 201103L
+    return SetSelect(manip,
+      static_cast<typename std::underlying_type<T>::type>(arg));
+#else  // __cplusplus < 201103L
+    return SetSelect(manip, static_cast<long>(arg));  // NOLINT(runtime/int)
+#endif  // __cplusplus
+  }
+
   // The standard output function. We must overload it to deal with locale
   template<class T> bool StringStandard(std::ostream *os, const T& arg) {
+    return StringEnum(os, arg, EnumTag<EnumNames<T>::kRegistered>());
+  }
+
+  template<class T> bool StringEnum(std::ostream *os, const T& arg,
+      EnumTag<false>) {
     (*os) << arg;
     return true;
   }
 
+  // For registered enum types, the name is output directly
+  template<class T> bool StringEnum(std::ostream *os, const T& arg,
+      EnumTag<true>) {
+    return WriteEnum(os, EnumNames<T>::Table(),
+      static_cast<long>(arg));  // NOLINT(runtime/int)
+  }
+
+  bool WriteEnum(std::ostream *os, const EnumTable& table,
+    long value);  // NOLINT(runtime/int)
+
   // It must be syntactically admissible to call the standard output
   // functions with locales, but semantically it is nonsense
   bool StringStandard(std::ostream *, const std::locale&) {
@@ -788,10 +1393,31 @@ class Format {
     return false;
   }
 
+#ifdef __SIZEOF_INT128__
+  // There is no operator<< for 128 bit integers
+  bool StringStandard(std::ostream *os, Int128 arg) {
+    WriteInteger128(os, static_cast<UInt128>(arg), true);
+    return true;
+  }
+
+  bool StringStandard(std::ostream *os, UInt128 arg) {
+    WriteInteger128(os, arg, false);
+    return true;
+  }
+#endif  // __SIZEOF_INT128__
+
+  // The bytes of the file are read
+  bool StringStandard(std::ostream *os, const FileRange& arg);
+
+  template<class T> bool StringStandard(std::ostream *os,
+      const NumberList<T>& arg) {
+    WriteNumbers(os, arg.data(), arg.size(), arg.separator());
+    return true;
+  }
+
   // The output function with a special treatment os string::npos
   template<class T> bool StringNpos(std::ostream *os, const T& arg) {
-    (*os) << arg;
-    return true;
+    return StringStandard(os, arg);
   }
 
   bool StringNpos(std::ostream *os, const std::string::size_type& arg) {
@@ -810,6 +1436,21 @@ class Format {
     return false;
   }
 
+  template<class T> bool StringNpos(std::ostream *os,
+      const NumberList<T>& arg) {
+    return StringStandard(os, arg);
+  }
+
+#ifdef __SIZEOF_INT128__
+  bool StringNpos(std::ostream *os, Int128 arg) {
+    return StringStandard(os, arg);
+  }
+
+  bool StringNpos(std::ostream *os, UInt128 arg) {
+    return StringStandard(os, arg);
+  }
+#endif  // __SIZEOF_INT128__
+
  public:
   Format(const Format& s) {
     parse_ = NULL;
@@ -1017,6 +1658,57 @@ class Format {
     Init(NULL, NULL, &output, true);
   }
 
+  Format(bool *success, Builder *output, const char *format, Special flags)
+    : abort_(false), success_(success), text_(format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, const std::string& format,
+      Special flags)
+    : abort_(false), success_(success), text_(format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, char format, Special flags)
+    : abort_(false), success_(success), text_(1, format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, bool format, Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(output, format);
+  }
+
+  Format(bool *success, Builder *output, const char *format)
+    : abort_(false), success_(success), text_(format) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, const std::string& format)
+    : abort_(false), success_(success), text_(format) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, char format)
+    : abort_(false), success_(success), text_(1, format) {
+    Init(output);
+  }
+
+  Format(bool *success, Builder *output, bool format)
+    : abort_(false), success_(success) {
+    Init(output, format);
+  }
+
+  Format(bool *success, Builder *output, Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(output, true);
+  }
+
+  Format(bool *success, Builder *output)
+    : abort_(false), success_(success) {
+    Init(output, true);
+  }
+
   Format(bool *success, const char *format, Special flags)
     : abort_(false), success_(success), text_(format), flags_(flags) {
     Init(NULL, NULL, NULL);
@@ -1217,6 +1909,56 @@ class Format {
     Init(NULL, NULL, &output, true);
   }
 
+  Format(Builder *output, const char *format, Special flags)
+    : abort_(true), text_(format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(Builder *output, const std::string& format, Special flags)
+    : abort_(true), text_(format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(Builder *output, char format, Special flags)
+    : abort_(true), text_(1, format), flags_(flags) {
+    Init(output);
+  }
+
+  Format(Builder *output, bool format, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(output, format);
+  }
+
+  Format(Builder *output, const char *format)
+    : abort_(true), text_(format) {
+    Init(output);
+  }
+
+  Format(Builder *output, const std::string& format)
+    : abort_(true), text_(format) {
+    Init(output);
+  }
+
+  Format(Builder *output, char format)
+    : abort_(true), text_(1, format) {
+    Init(output);
+  }
+
+  Format(Builder *output, bool format)
+    : abort_(true) {
+    Init(output, format);
+  }
+
+  Format(Builder *output, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(output, true);
+  }
+
+  explicit Format(Builder *output)
+    : abort_(true) {
+    Init(output, true);
+  }
+
   Format(const char *format, Special flags)
     : abort_(true), text_(format), flags_(flags) {
     Init(NULL, NULL, NULL);
@@ -1267,6 +2009,109 @@ class Format {
     Init(NULL, NULL, NULL, true);
   }
 
+  // Use a precompiled format; see class Template below
+  Format(bool *success, std::string *output, const Template& plan,
+      Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(plan, output, NULL, NULL, NULL);
+  }
+
+  Format(bool *success, std::string *output, const Template& plan)
+    : abort_(false), success_(success) {
+    Init(plan, output, NULL, NULL, NULL);
+  }
+
+  Format(bool *success, FILE *output, const Template& plan, Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(plan, NULL, output, NULL, NULL);
+  }
+
+  Format(bool *success, FILE *output, const Template& plan)
+    : abort_(false), success_(success) {
+    Init(plan, NULL, output, NULL, NULL);
+  }
+
+  Format(bool *success, std::ostream& output, const Template& plan,
+      Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(plan, NULL, NULL, &output, NULL);
+  }
+
+  Format(bool *success, std::ostream& output, const Template& plan)
+    : abort_(false), success_(success) {
+    Init(plan, NULL, NULL, &output, NULL);
+  }
+
+  Format(bool *success, Builder *output, const Template& plan, Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(plan, NULL, NULL, NULL, output);
+  }
+
+  Format(bool *success, Builder *output, const Template& plan)
+    : abort_(false), success_(success) {
+    Init(plan, NULL, NULL, NULL, output);
+  }
+
+  Format(bool *success, const Template& plan, Special flags)
+    : abort_(false), success_(success), flags_(flags) {
+    Init(plan, NULL, NULL, NULL, NULL);
+  }
+
+  Format(bool *success, const Template& plan)
+    : abort_(false), success_(success) {
+    Init(plan, NULL, NULL, NULL, NULL);
+  }
+
+  Format(std::string *output, const Template& plan, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(plan, output, NULL, NULL, NULL);
+  }
+
+  Format(std::string *output, const Template& plan)
+    : abort_(true) {
+    Init(plan, output, NULL, NULL, NULL);
+  }
+
+  Format(FILE *output, const Template& plan, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(plan, NULL, output, NULL, NULL);
+  }
+
+  Format(FILE *output, const Template& plan)
+    : abort_(true) {
+    Init(plan, NULL, output, NULL, NULL);
+  }
+
+  Format(std::ostream& output, const Template& plan, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(plan, NULL, NULL, &output, NULL);
+  }
+
+  Format(std::ostream& output, const Template& plan)
+    : abort_(true) {
+    Init(plan, NULL, NULL, &output, NULL);
+  }
+
+  Format(Builder *output, const Template& plan, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(plan, NULL, NULL, NULL, output);
+  }
+
+  Format(Builder *output, const Template& plan)
+    : abort_(true) {
+    Init(plan, NULL, NULL, NULL, output);
+  }
+
+  Format(const Template& plan, Special flags)
+    : abort_(true), flags_(flags) {
+    Init(plan, NULL, NULL, NULL, NULL);
+  }
+
+  explicit Format(const Template& plan)
+    : abort_(true) {
+    Init(plan, NULL, NULL, NULL, NULL);
+  }
+
   void set_success() {
     abort_ = true;
     success_ = NULL;
@@ -1304,6 +2149,11 @@ class Format {
     OutputInternal(ostream);
   }
 
+  void Output(Builder *builder) const {
+    Check();
+    OutputInternal(builder);
+  }
+
   const std::string& StringReference() const {
     Check();
     return text_;
@@ -1314,6 +2164,14 @@ class Format {
     return text_;
   }
 
+#if __cplusplus >= 201103L
+  // Move the produced string into a SharedText; afterwards, it is empty here
+  SharedText Take() {
+    Check();
+    return SharedText(std::move(text_));
+  }
+#endif
+
   operator std::string() const {
     return str();
   }
@@ -1347,12 +2205,28 @@ class Format {
   }
 
   template<class T> Format& operator%(const T& arg) {
+    return Insert(arg);
+  }
+
+  template<class F> Format& operator%(const Lazy<F>& arg) {
+    if (!parse_) {
+      return SuperfluousArgument();
+    }
+    return (*this % arg.function()());
+  }
+
+  Format& operator%(const FileRange& arg) {
+    if (parse_ && DeferFileRange(arg)) {
+      return *this;
+    }
+    return Insert(arg);
+  }
+
+ private:
+  template<class T> Format& Insert(const T& arg) {
     Parse *parse(parse_);
     if (!parse) {
-      if (error_ == Error::kNone) {
-        Throw(Error::kTooManyArguments);
-      }
-      return *this;
+      return SuperfluousArgument();
     }
     if (parse->simple_) {
       std::ostringstream os;
@@ -1363,6 +2237,17 @@ class Format {
       InitialOutput();
       return *this;
     }
+    Manip *direct(parse->direct_[static_cast<Parse::size_type>(
+      parse->current_arg_ - parse->args_.begin())]);
+    if (direct != NULL) {
+      if (!StringStandard(&(direct->ostream_), arg)) {
+        return *this;
+      }
+      if (++(parse->current_arg_) == parse_->args_.end()) {
+        FinishInsertingArgs();
+      }
+      return *this;
+    }
     const Parse::ArgsDefines& defines = *(parse->current_arg_);
     for (Parse::ArgsDefines::const_iterator it(defines.begin());
       it != defines.end(); ++it) {
@@ -1405,6 +2290,12 @@ class Format {
       if ((extensions & Extensions::kIgnore) != Extensions::kNone) {
         continue;
       }
+      if ((extensions & Extensions::kSelect) != Extensions::kNone) {
+        if (!SetSelect(manip, arg)) {
+          return *this;
+        }
+        continue;
+      }
       if ((extensions & Extensions::kStringNpos) != Extensions::kNone) {
         if (!StringNpos(&os, arg)) {
           return *this;
@@ -1422,6 +2313,60 @@ class Format {
   }
 };
 
+// A format string which is parsed only once.
+// Format (and Print, PrintError, Say, SayError) objects can be constructed
+// from a Template instead of a format string: Then the parsed data is only
+// copied which is cheaper than parsing the format string again.
+// A Template is not modified by usage (except for a hint on the length of
+// the results) and can thus be shared by threads. It may be destroyed while
+// objects constructed from it still wait for arguments.
+// Errors in the format string are reported when the Template is used
+// (or can be checked in advance with error()).
+
+class Template {
+ public:
+  explicit Template(const char *format)
+    : compiled_(static_cast<bool *>(NULL), format),
+    estimate_(new Format::Estimate) {
+  }
+
+  explicit Template(const std::string& format)
+    : compiled_(static_cast<bool *>(NULL), format),
+    estimate_(new Format::Estimate) {
+  }
+
+  ~Template() {
+    estimate_->Release();
+  }
+
+  // Return the error of the format string (or Error::kNone)
+  Error::Code error() const {
+    if (compiled_.parse_ != NULL) {
+      return Error::kNone;
+    }
+    return compiled_.error_;
+  }
+
+  // The capacity reserved for the next result
+  std::size_t estimate() const;
+
+ private:
+  friend class Format;
+
+  // The format with all arguments still missing (unless there are none)
+  Format compiled_;
+
+  Format::Estimate *estimate_;
+
+#if __cplusplus >= 201103L
+  Template(const Template&) = delete;
+  Template& operator=(const Template&) = delete;
+#else  // __cplusplus < 201103L
+  Template(const Template&);
+  Template& operator=(const Template&);
+#endif  // __cplusplus
+};
+
 class Print : public Format {
  public:
   Print(bool *success, const char *format, Special flags)
@@ -1503,6 +2448,22 @@ class Print : public Format {
   Print()
     : Format(stdout) {
   }
+
+  Print(bool *success, const Template& plan, Special flags)
+    : Format(success, stdout, plan, flags) {
+  }
+
+  Print(bool *success, const Template& plan)
+    : Format(success, stdout, plan) {
+  }
+
+  Print(const Template& plan, Special flags)
+    : Format(stdout, plan, flags) {
+  }
+
+  explicit Print(const Template& plan)
+    : Format(stdout, plan) {
+  }
 };
 
 class PrintError : public Format {
@@ -1586,6 +2547,22 @@ class PrintError : public Format {
   PrintError()
     : Format(stderr) {
   }
+
+  PrintError(bool *success, const Template& plan, Special flags)
+    : Format(success, stderr, plan, flags) {
+  }
+
+  PrintError(bool *success, const Template& plan)
+    : Format(success, stderr, plan) {
+  }
+
+  PrintError(const Template& plan, Special flags)
+    : Format(stderr, plan, flags) {
+  }
+
+  explicit PrintError(const Template& plan)
+    : Format(stderr, plan) {
+  }
 };
 
 class Say : public Format {
@@ -1669,6 +2646,22 @@ class Say : public Format {
   Say()
     : Format(stdout, Special::Newline()) {
   }
+
+  Say(bool *success, const Template& plan, Special flags)
+    : Format(success, stdout, plan, flags | Special::kNewline) {
+  }
+
+  Say(bool *success, const Template& plan)
+    : Format(success, stdout, plan, Special::Newline()) {
+  }
+
+  Say(const Template& plan, Special flags)
+    : Format(stdout, plan, flags | Special::kNewline) {
+  }
+
+  explicit Say(const Template& plan)
+    : Format(stdout, plan, Special::Newline()) {
+  }
 };
 
 class SayError : public Format {
@@ -1712,6 +2705,14 @@ class SayError : public Format {
   SayError()
     : Format(stderr, Special::NewlineFlush()) {
   }
+
+  SayError(bool *success, const Template& plan)
+    : Format(success, stderr, plan, Special::NewlineFlush()) {
+  }
+
+  explicit SayError(const Template& plan)
+    : Format(stderr, plan, Special::NewlineFlush()) {
+  }
 };
 
 }  // namespace osformat
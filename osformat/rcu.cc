@@ -0,0 +1,162 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/rcu.h"
+
+#if __cplusplus >= 201103L
+
+#include <stdint.h>  // uint64_t
+
+#include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+namespace osformat {
+
+// The slot of a thread; it is padded so that the epochs of two slots
+// (allocated separately) never share a cache line
+class RcuReader {
+ public:
+  // The epoch when the outermost read section was entered, or 0
+  std::atomic<uint64_t> epoch_;
+  unsigned int nesting_;
+  char padding_[64];
+
+  RcuReader()
+    : epoch_(0), nesting_(0) {
+  }
+};
+
+typedef std::vector<RcuReader *> RcuReaderList;
+
+// Declarations of some static helper functions:
+
+static std::mutex& Registry();
+
+static RcuReaderList& Readers();
+
+static RcuReaderList& FreeReaders();
+
+static std::atomic<uint64_t>& GlobalEpoch();
+
+static RcuReader& ThisReader();
+
+
+// Definitions of some static helper functions:
+
+// Function-local statics are independent of static initialization order
+
+static std::mutex& Registry() {
+  static std::mutex registry;
+  return registry;
+}
+
+// All slots ever created: They are never freed (but reused), so that
+// Synchronize() can read them without holding the lock
+static RcuReaderList& Readers() {
+  static RcuReaderList readers;
+  return readers;
+}
+
+// The slots of exited threads
+static RcuReaderList& FreeReaders() {
+  static RcuReaderList free_readers;
+  return free_readers;
+}
+
+static std::atomic<uint64_t>& GlobalEpoch() {
+  static std::atomic<uint64_t> epoch(1);
+  return epoch;
+}
+
+// Take a slot with the first usage in a thread; release it at exit
+class RcuRegistration {
+ public:
+  RcuReader *reader_;
+
+  RcuRegistration() {
+    std::lock_guard<std::mutex> lock(Registry());
+    RcuReaderList& free_readers = FreeReaders();
+    if (!free_readers.empty()) {
+      reader_ = free_readers.back();
+      free_readers.pop_back();
+      return;
+    }
+    RcuReaderList& readers = Readers();
+    // Releasing the slot at exit must not need an allocation
+    free_readers.reserve(readers.size() + 1);
+    reader_ = new RcuReader;
+    try {
+      readers.push_back(reader_);
+    } catch (...) {
+      delete reader_;
+      throw;
+    }
+  }
+
+  ~RcuRegistration() {
+    std::lock_guard<std::mutex> lock(Registry());
+    FreeReaders().push_back(reader_);
+  }
+};
+
+static RcuReader& ThisReader() {
+  static thread_local RcuRegistration registration;
+  return *registration.reader_;
+}
+
+void Rcu::ReadLock() {
+  RcuReader& reader = ThisReader();
+  if ((reader.nesting_)++ != 0) {
+    return;
+  }
+  reader.epoch_.store(GlobalEpoch().load(std::memory_order_acquire),
+    std::memory_order_relaxed);
+  // Order the announcement before all reads of the protected data.
+  // This pairs with the fence in Synchronize()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Rcu::ReadUnlock() {
+  RcuReader& reader = ThisReader();
+  if (--(reader.nesting_) == 0) {
+    reader.epoch_.store(0, std::memory_order_release);
+  }
+}
+
+void Rcu::Synchronize() {
+  uint64_t target(GlobalEpoch().fetch_add(1, std::memory_order_seq_cst) + 1);
+  // Order the publication of new data before reading the slots
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // The lock is not held while waiting, so that new threads can register.
+  // A thread registering later reads the epoch only after taking the lock,
+  // so it cannot see the old data.
+  RcuReaderList readers;
+  {
+    std::lock_guard<std::mutex> lock(Registry());
+    readers = Readers();
+  }
+  for (RcuReaderList::const_iterator it(readers.begin());
+    it != readers.end(); ++it) {
+    for (;;) {
+      uint64_t epoch((*it)->epoch_.load(std::memory_order_acquire));
+      if ((epoch == 0) || (epoch >= target)) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
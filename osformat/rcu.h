@@ -0,0 +1,56 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_RCU_H_
+#define OSFORMAT_RCU_H_ 1
+
+#if __cplusplus >= 201103L
+
+namespace osformat {
+
+// A minimal read-copy-update domain (epoch based).
+// Readers enclose accesses to shared data in a read section; this costs
+// neither a lock nor a write to a shared cache line: Each thread announces
+// the current epoch in its own slot.
+// A writer first publishes new data (with an atomic store) and then calls
+// Synchronize() which waits until all read sections which might still see
+// the old data are left; afterwards the old data can be freed.
+// Read sections may be nested. Synchronize() must not be called from
+// within a read section.
+
+class Rcu {
+ public:
+  static void ReadLock();
+
+  static void ReadUnlock();
+
+  static void Synchronize();
+
+  // Enter a read section for the lifetime of the object
+  class ReadSection {
+   public:
+    ReadSection() {
+      ReadLock();
+    }
+
+    ~ReadSection() {
+      ReadUnlock();
+    }
+
+    ReadSection(const ReadSection&) = delete;
+    ReadSection& operator=(const ReadSection&) = delete;
+  };
+
+ private:
+  Rcu() {}  // Do not instantiate this purely static class by accident
+};
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
+
+#endif  // OSFORMAT_RCU_H_
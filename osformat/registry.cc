@@ -0,0 +1,121 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/registry.h"
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+
+#include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+using std::string;
+
+namespace osformat {
+
+typedef std::vector<const FormatRegistry::Entry *> EntryList;
+
+// Declarations of some static helper functions:
+
+static std::mutex& Lock();
+
+// The entries in the order of their ids
+static EntryList& Entries();
+
+// Compile entry with the next id; Lock() must be held
+static void CompileLocked(FormatRegistry::Entry *entry);
+
+
+// Definitions of some static helper functions:
+
+// Function-local statics are independent of static initialization order
+
+static std::mutex& Lock() {
+  static std::mutex lock;
+  return lock;
+}
+
+static EntryList& Entries() {
+  static EntryList entries;
+  return entries;
+}
+
+static void CompileLocked(FormatRegistry::Entry *entry) {
+  EntryList& entries = Entries();
+  entry->id_ = static_cast<unsigned int>(entries.size());
+  entries.push_back(entry);
+  entry->plan_.store(new Template(entry->format_), std::memory_order_release);
+}
+
+std::size_t FormatRegistry::Compile(Entry *begin, Entry *end) {
+  std::size_t count(0);
+  std::lock_guard<std::mutex> lock(Lock());
+  for (; begin < end; ++begin) {
+    if (begin->plan_.load(std::memory_order_relaxed) == NULL) {
+      CompileLocked(begin);
+      ++count;
+    }
+  }
+  return count;
+}
+
+const Template& FormatRegistry::Compile(Entry *entry) {
+  std::lock_guard<std::mutex> lock(Lock());
+  if (entry->plan_.load(std::memory_order_relaxed) == NULL) {
+    CompileLocked(entry);
+  }
+  return *(entry->plan_.load(std::memory_order_relaxed));
+}
+
+std::size_t FormatRegistry::size() {
+  std::lock_guard<std::mutex> lock(Lock());
+  return Entries().size();
+}
+
+const FormatRegistry::Entry *FormatRegistry::Find(unsigned int id) {
+  std::lock_guard<std::mutex> lock(Lock());
+  const EntryList& entries = Entries();
+  return ((id < entries.size()) ? entries[id] : NULL);
+}
+
+void FormatRegistry::Dump(string *append) {
+  std::lock_guard<std::mutex> lock(Lock());
+  const EntryList& entries = Entries();
+  for (EntryList::const_iterator it(entries.begin());
+    it != entries.end(); ++it) {
+    const Entry& entry = **it;
+    Format(append, "%s\t%s:%s\t") % entry.id_ % entry.file_ % entry.line_;
+    for (const char *s(entry.format_); *s != '\0'; ++s) {
+      switch (*s) {
+        case '\\':
+          append->append("\\\\");
+          break;
+        case '\t':
+          append->append("\\t");
+          break;
+        case '\n':
+          append->append("\\n");
+          break;
+        default:
+          append->push_back(*s);
+          break;
+      }
+    }
+    append->push_back('\n');
+  }
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 201103L
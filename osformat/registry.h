@@ -0,0 +1,130 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_REGISTRY_H_
+#define OSFORMAT_REGISTRY_H_ 1
+
+#if __cplusplus >= 201103L
+
+#include "osformat/osformat.h"
+
+#include <atomic>
+#include <cstdio>  // size_t
+#include <string>
+
+namespace osformat {
+
+// A registry of all format literals of the program:
+// OSFORMAT_REGISTERED("literal") places the literal and its source location
+// into the linker section osformat_registry (with GCC or clang on ELF
+// systems) and evaluates to the compiled Template of the literal.
+// RegisterFormats() compiles all literals of the calling module at once
+// and assigns dense ids, so that afterwards a usage costs only one atomic
+// load. A literal which is not compiled yet (e.g. without linker section
+// support) is compiled on first usage.
+// The table of ids can be dumped for decoders of binary logs.
+// Templates are never freed.
+
+class FormatRegistry {
+ public:
+  // The data of one usage of OSFORMAT_REGISTERED. The section is walked
+  // as an array, so the entries must be spaced by sizeof(Entry): Hence,
+  // the type and each entry in the section have this fixed alignment.
+  static const std::size_t kAlignment = 32;
+
+  class alignas(kAlignment) Entry {
+   public:
+    const char *format_;
+    const char *file_;
+    unsigned int line_;
+    unsigned int id_;
+    std::atomic<const Template *> plan_;
+
+    unsigned int id() const {
+      return id_;
+    }
+  };
+
+  static const Template& Plan(Entry *entry) {
+    const Template *plan(entry->plan_.load(std::memory_order_acquire));
+    return ((plan != NULL) ? *plan : Compile(entry));
+  }
+
+  // Compile all entries in [begin, end) which are not compiled yet;
+  // return the number of entries compiled
+  static std::size_t Compile(Entry *begin, Entry *end);
+
+  // Compile entry if it is not compiled yet
+  static const Template& Compile(Entry *entry);
+
+  // The number of compiled entries; their ids are 0 ... size() - 1
+  static std::size_t size();
+
+  // Return NULL if id is not assigned
+  static const Entry *Find(unsigned int id);
+
+  // Append one line "id<TAB>file:line<TAB>format" for each compiled entry;
+  // in the format, \, tab, and newline are escaped as \\, \t, and \n
+  static void Dump(std::string *append);
+
+ private:
+  FormatRegistry() = delete;
+};
+
+}  // namespace osformat
+
+#if defined(__GNUC__) && defined(__ELF__)
+
+#define OSFORMAT_REGISTRY_SECTION \
+  __attribute__((section("osformat_registry"), used, \
+    aligned(::osformat::FormatRegistry::kAlignment)))
+
+// The linker defines these for the section of each module
+extern "C" {
+extern osformat::FormatRegistry::Entry __start_osformat_registry[]
+  __attribute__((weak));
+extern osformat::FormatRegistry::Entry __stop_osformat_registry[]
+  __attribute__((weak));
+}
+
+namespace osformat {
+
+// Compile all literals of the module (executable or shared library) which
+// calls this; return the number of entries compiled.
+// This is static, so that each module refers to its own section.
+static inline std::size_t RegisterFormats() {
+  return FormatRegistry::Compile(__start_osformat_registry,
+    __stop_osformat_registry);
+}
+
+}  // namespace osformat
+
+#else  // !defined(__GNUC__) || !defined(__ELF__)
+
+#define OSFORMAT_REGISTRY_SECTION
+
+namespace osformat {
+
+static inline std::size_t RegisterFormats() {
+  return 0;
+}
+
+}  // namespace osformat
+
+#endif  // __GNUC__ && __ELF__
+
+#define OSFORMAT_REGISTERED(format) \
+  (::osformat::FormatRegistry::Plan( \
+    []() -> ::osformat::FormatRegistry::Entry * { \
+      static ::osformat::FormatRegistry::Entry entry \
+        OSFORMAT_REGISTRY_SECTION = { format, __FILE__, __LINE__, 0, {} }; \
+      return &entry; \
+    }()))
+
+#endif  // __cplusplus >= 201103L
+
+#endif  // OSFORMAT_REGISTRY_H_
@@ -0,0 +1,78 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/sampler.h"
+
+#include "osformat/instrumentation.h"
+#include "osformat/osformat.h"
+
+#include <stdint.h>  // uint32_t, uint64_t
+
+#if __cplusplus >= 201103L
+#define OSFORMAT_THREAD_LOCAL thread_local
+#elif defined(__GNUC__)
+#define OSFORMAT_THREAD_LOCAL __thread
+#else
+#define OSFORMAT_THREAD_LOCAL
+#endif
+
+namespace osformat {
+
+// The xorshift64* state of the thread; 0 means not seeded yet
+static OSFORMAT_THREAD_LOCAL uint64_t state;
+
+// Declarations of some static helper functions:
+
+static uint64_t Mix(uint64_t x);
+
+inline static uint32_t Next();
+
+
+// Definitions of some static helper functions:
+
+// The splitmix64 finalizer: Distinct seeds give unrelated states
+static uint64_t Mix(uint64_t x) {
+  x += UINT64_C(0x9E3779B97F4A7C15);
+  x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+  x ^= (x >> 31);
+  return ((x == 0) ? 1 : x);
+}
+
+inline static uint32_t Next() {
+  uint64_t x(state);
+  if (x == 0) {
+    // The address of the state differs for each thread
+    x = Mix(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&state)));
+  }
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  state = x;
+  return static_cast<uint32_t>((x * UINT64_C(0x2545F4914F6CDD1D)) >> 32);
+}
+
+Special Sampler::Pick() const {
+  uint64_t rate(rate_);
+  // Keep if the random number falls into the first of rate equal parts
+  if ((rate <= 1) || (((Next() * rate) >> 32) == 0)) {
+    Instrumentation::Increment(Instrumentation::kSampledKept);
+    return Special::None();
+  }
+  Instrumentation::Increment(Instrumentation::kSampledDropped);
+  return Special::Mute();
+}
+
+void Sampler::Seed(uint64_t seed) {
+  state = Mix(seed);
+}
+
+}  // namespace osformat
@@ -0,0 +1,57 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_SAMPLER_H_
+#define OSFORMAT_SAMPLER_H_ 1
+
+#include "osformat/osformat.h"
+
+#include <stdint.h>  // uint64_t
+
+namespace osformat {
+
+// Keep randomly 1 out of rate messages: Pick() returns the flags to pass
+// to the Format (or Print, Say, ...) constructor; for a dropped message,
+// this is Special::Mute(), so that neither the format string is parsed nor
+// any argument is converted.
+// The random numbers come from a cheap thread-local generator.
+// The decisions are counted in Instrumentation::kSampledKept and
+// Instrumentation::kSampledDropped.
+
+class Sampler {
+ public:
+  explicit Sampler(unsigned int rate)
+    : rate_(rate) {
+  }
+
+  // Return Special::None() with probability 1/rate, otherwise Special::Mute()
+  Special Pick() const;
+
+  // Return flags or Special::Mute()
+  Special Pick(Special flags) const {
+    return (Pick() | flags);
+  }
+
+  unsigned int rate() const {
+    return rate_;
+  }
+
+  // A rate of 0 or 1 keeps all messages
+  void set_rate(unsigned int rate) {
+    rate_ = rate;
+  }
+
+  // Seed the generator of the calling thread (e.g. for reproducible tests)
+  static void Seed(uint64_t seed);
+
+ private:
+  unsigned int rate_;
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_SAMPLER_H_
@@ -0,0 +1,502 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_STATIC_FORMAT_H_
+#define OSFORMAT_STATIC_FORMAT_H_ 1
+
+#if __cplusplus >= 202002L
+
+#include <cstddef>  // size_t
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace osformat {
+
+// Formatting at compile time: If the format and all arguments are constants,
+//   constexpr auto banner = osformat::static_format<"%s %d.%02d",
+//     osformat::StaticText("prog"), 1, 2>();
+// gives a null-terminated constant character array of exactly the needed
+// size, so that nothing is left to do at runtime.
+// Arguments can be integers, bool, char, or StaticText (strings).
+// The result is the same as with Format; supported are argument numbers,
+// the modifiers # + space 0 _ - : and field widths, and the specifiers
+// s S d D x X o O n ?{...} (the float specifiers act like s).
+// Indirect modifiers (* .* / ~) are not possible at compile time.
+// Errors in the format (or wrong numbers of arguments) are compile errors.
+
+// A string literal usable as a template argument
+template<std::size_t N> class StaticText {
+ public:
+  char data_[N];
+
+  consteval StaticText(const char (&text)[N]) {  // NOLINT(runtime/explicit)
+    for (std::size_t i(0); i != N; ++i) {
+      data_[i] = text[i];
+    }
+  }
+
+  constexpr std::size_t size() const {
+    return N - 1;
+  }
+};
+
+// The result of static_format
+template<std::size_t N> class StaticString {
+ public:
+  char data_[N + 1];
+
+  constexpr const char *c_str() const {
+    return data_;
+  }
+
+  constexpr const char *data() const {
+    return data_;
+  }
+
+  static constexpr std::size_t size() {
+    return N;
+  }
+
+  constexpr std::string_view view() const {
+    return std::string_view(data_, N);
+  }
+
+  constexpr operator std::string_view() const {  // NOLINT(runtime/explicit)
+    return view();
+  }
+
+  std::string str() const {
+    return std::string(data_, N);
+  }
+};
+
+// Used internally by static_format: An argument in a uniform representation
+class StaticArg {
+ public:
+  enum Kind {
+    kInteger,
+    kBool,
+    kChar,
+    kText
+  };
+
+  Kind kind_;
+  bool signed_, negative_, size_type_;
+  unsigned long long magnitude_;  // NOLINT(runtime/int)
+  unsigned long long bits_;  // NOLINT(runtime/int)
+  char char_;
+  const char *text_;
+  std::size_t size_;
+
+  constexpr StaticArg()
+    : kind_(kText), signed_(false), negative_(false), size_type_(false),
+    magnitude_(0), bits_(0), char_('\0'), text_(""), size_(0) {
+  }
+};
+
+template<class T> consteval StaticArg MakeStaticArg(const T& value) {
+  typedef unsigned long long Bits;  // NOLINT(runtime/int)
+  static_assert(std::is_integral_v<T>,
+    "static_format arguments must be integers, bool, char, or StaticText");
+  static_assert(!std::is_same_v<T, wchar_t> && !std::is_same_v<T, char8_t> &&
+    !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>,
+    "static_format does not support wide characters");
+  StaticArg arg;
+  if constexpr (std::is_same_v<T, bool>) {
+    arg.kind_ = StaticArg::kBool;
+    arg.signed_ = true;
+    arg.magnitude_ = arg.bits_ = (value ? 1 : 0);
+  } else if constexpr (std::is_same_v<T, char> ||
+      std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+    arg.kind_ = StaticArg::kChar;
+    arg.char_ = static_cast<char>(value);
+  } else {
+    arg.kind_ = StaticArg::kInteger;
+    arg.signed_ = std::is_signed_v<T>;
+    arg.negative_ = (value < 0);
+    arg.size_type_ = std::is_same_v<T, std::string::size_type>;
+    arg.bits_ = static_cast<Bits>(static_cast<std::make_unsigned_t<T>>(value));
+    arg.magnitude_ = (arg.negative_ ? (0 - static_cast<Bits>(value)) :
+      static_cast<Bits>(value));
+  }
+  return arg;
+}
+
+template<std::size_t N> consteval StaticArg MakeStaticArg(
+    const StaticText<N>& value) {
+  StaticArg arg;
+  arg.text_ = value.data_;
+  arg.size_ = value.size();
+  return arg;
+}
+
+// Used internally by static_format: Calling this non-constexpr function
+// makes the constant evaluation fail with the message in the diagnostics
+inline void StaticFormatError(const char *) {
+}
+
+// Used internally by static_format: Output to out (if not NULL),
+// returning the length of the result
+class StaticFormatter {
+ public:
+  consteval StaticFormatter(const char *format, std::size_t size,
+      const StaticArg *args, std::size_t count, char *out)
+    : format_(format), size_(size), args_(args), count_(count), out_(out),
+    length_(0), used_(0), explicit_(NULL), plus_space_(false) {
+  }
+
+  consteval std::size_t Run() {
+    // The explicit argument numbers must be known to assign the free ones
+    explicit_ = new bool[count_ + 1]();
+    Walk(false);
+    Walk(true);
+    delete[] explicit_;
+    if (used_ != count_) {
+      StaticFormatError("too many arguments passed (or too few specified)");
+    }
+    return length_;
+  }
+
+ private:
+  enum Adjust {
+    kRight,
+    kLeft,
+    kInternal
+  };
+
+  const char *format_;
+  std::size_t size_;
+  const StaticArg *args_;
+  std::size_t count_;
+  char *out_;
+  std::size_t length_, used_;
+  bool *explicit_;
+  bool plus_space_;  // The next + is output as space
+
+  consteval void Put(char c) {
+    if (plus_space_ && (c == '+')) {
+      plus_space_ = false;
+      c = ' ';
+    }
+    if (out_ != NULL) {
+      out_[length_] = c;
+    }
+    ++length_;
+  }
+
+  consteval void Put(const char *text, std::size_t size) {
+    for (std::size_t i(0); i != size; ++i) {
+      Put(text[i]);
+    }
+  }
+
+  consteval void Pad(char fill, std::size_t count) {
+    for (; count != 0; --count) {
+      Put(fill);
+    }
+  }
+
+  static consteval bool IsDigit(char c) {
+    return ((c >= '0') && (c <= '9'));
+  }
+
+  // Parse a number; i is at the first digit and moved behind the last
+  consteval std::size_t Number(std::size_t *i) const {
+    std::size_t result(0);
+    for (; (*i != size_) && IsDigit(format_[*i]); ++*i) {
+      result = result * 10 + static_cast<std::size_t>(format_[*i] - '0');
+    }
+    return result;
+  }
+
+  // The first pass only collects the explicit argument numbers
+  consteval void Walk(bool render) {
+    std::size_t next_free(0);
+    for (std::size_t i(0); i != size_;) {
+      char c(format_[i++]);
+      if (c != '%') {
+        if (render) {
+          Put(c);
+        }
+        continue;
+      }
+      if (i == size_) {
+        StaticFormatError("trailing %");
+        return;
+      }
+      if (format_[i] == '%') {
+        ++i;
+        if (render) {
+          Put('%');
+        }
+        continue;
+      }
+      std::size_t argnum(0), j(i);
+      bool numbered(false);
+      if (IsDigit(format_[i])) {
+        std::size_t number(Number(&j));
+        if ((j != size_) && (format_[j] == '$')) {
+          if ((number == 0) || (number > count_)) {
+            StaticFormatError("too few arguments passed (or too many "
+              "specified)");
+            return;
+          }
+          numbered = true;
+          argnum = number - 1;
+          explicit_[argnum] = true;
+          i = j + 1;
+        }
+      }
+      bool showbase(false), showpos(false), plus_space(false);
+      char fill(' ');
+      Adjust adjust(kRight);
+      std::size_t width(0);
+      for (bool modifiers(true); modifiers;) {
+        if (i == size_) {
+          StaticFormatError("missing specifier");
+          return;
+        }
+        switch (format_[i]) {
+          case '#':
+            showbase = true;
+            break;
+          case '+':
+            showpos = true;
+            break;
+          case ' ':
+            showpos = plus_space = true;
+            break;
+          case '0':
+            fill = '0';
+            break;
+          case '_':
+            if (++i == size_) {
+              StaticFormatError("missing fill character");
+              return;
+            }
+            fill = format_[i];
+            break;
+          case '-':
+            adjust = kLeft;
+            break;
+          case ':':
+            adjust = kInternal;
+            break;
+          case '.':
+            ++i;
+            if ((i != size_) && (format_[i] == '*')) {
+              StaticFormatError("indirect modifiers are not possible");
+              return;
+            }
+            Number(&i);  // The precision has no effect without floats
+            continue;
+          case '*':
+          case '/':
+          case '~':
+            StaticFormatError("indirect modifiers are not possible");
+            return;
+          default:
+            if (IsDigit(format_[i])) {
+              width = Number(&i);
+              continue;
+            }
+            modifiers = false;
+            continue;
+        }
+        ++i;
+      }
+      char specifier(format_[i++]);
+      if (render && !numbered) {
+        while ((next_free != count_) && explicit_[next_free]) {
+          ++next_free;
+        }
+        if (next_free == count_) {
+          StaticFormatError("too few arguments passed (or too many "
+            "specified)");
+          return;
+        }
+        argnum = next_free++;
+      }
+      if (specifier == '?') {
+        Select(&i, render ? (args_ + argnum) : NULL);
+      }
+      if (!render) {
+        continue;
+      }
+      if (argnum >= used_) {
+        used_ = argnum + 1;
+      }
+      const StaticArg& arg(args_[argnum]);
+      switch (specifier) {
+        case '?':
+        case 'n':
+          break;
+        case 's':
+        case 'S':
+        case 'd':
+        case 'D':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'O':
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'a':
+        case 'A':
+          plus_space_ = plus_space;
+          Field(arg, specifier, showbase, showpos, fill, adjust, width);
+          plus_space_ = false;
+          break;
+        default:
+          StaticFormatError("unknown specifier");
+          return;
+      }
+    }
+  }
+
+  // i is behind ? and is moved behind }; if arg is not NULL,
+  // the selected alternative is output
+  consteval void Select(std::size_t *i, const StaticArg *arg) {
+    if (arg == NULL) {
+      Alternatives(i, false, 0);
+      return;
+    }
+    if ((arg->kind_ != StaticArg::kInteger) &&
+      (arg->kind_ != StaticArg::kBool)) {
+      StaticFormatError("select argument is not numeric");
+      return;
+    }
+    std::size_t start(*i);
+    std::size_t last(Alternatives(&start, false, 0) - 1);
+    Alternatives(i, true, ((arg->negative_ || (arg->magnitude_ > last)) ?
+      last : static_cast<std::size_t>(arg->magnitude_)));
+  }
+
+  // Move i behind } and return the number of alternatives;
+  // if output is true, alternative choose is output
+  consteval std::size_t Alternatives(std::size_t *i, bool output,
+      std::size_t choose) {
+    std::size_t k(*i);
+    if ((k == size_) || (format_[k] != '{')) {
+      StaticFormatError("malformed %?{...}");
+      return 0;
+    }
+    std::size_t current(0);
+    for (++k; k != size_; ++k) {
+      char c(format_[k]);
+      if (c == '}') {
+        *i = k + 1;
+        return current + 1;
+      }
+      if (c == '|') {
+        ++current;
+        continue;
+      }
+      if ((c == '%') && (++k == size_)) {
+        break;
+      }
+      if (output && (current == choose)) {
+        Put(format_[k]);
+      }
+    }
+    StaticFormatError("malformed %?{...}");
+    return 0;
+  }
+
+  consteval void Field(const StaticArg& arg, char specifier, bool showbase,
+      bool showpos, char fill, Adjust adjust, std::size_t width) {
+    const bool special((specifier == 'S') || (specifier == 'd') ||
+      (specifier == 'D'));
+    const bool uppercase((specifier >= 'A') && (specifier <= 'Z'));
+    const int base(((specifier == 'x') || (specifier == 'X')) ? 16 :
+      (((specifier == 'o') || (specifier == 'O')) ? 8 : 10));
+    const char *prefix("");
+    std::size_t prefix_size(0);
+    const char *body(arg.text_);
+    std::size_t body_size(arg.size_);
+    bool numeric(false);
+    char digits[32] = {};
+    if (arg.kind_ == StaticArg::kChar) {
+      body = &arg.char_;
+      body_size = 1;
+    } else if ((arg.kind_ == StaticArg::kBool) && special) {
+      body = ((arg.bits_ != 0) ? "true" : "false");
+      body_size = ((arg.bits_ != 0) ? 4 : 5);
+    } else if (special && arg.size_type_ &&
+      (arg.bits_ == static_cast<unsigned long long>(  // NOLINT(runtime/int)
+        std::string::npos))) {
+      body = "std::string::npos";
+      body_size = 17;
+    } else if (arg.kind_ != StaticArg::kText) {
+      numeric = true;
+      unsigned long long value(  // NOLINT(runtime/int)
+        (base == 10) ? arg.magnitude_ : arg.bits_);
+      std::size_t end(sizeof(digits));
+      do {
+        int digit(static_cast<int>(value % static_cast<unsigned>(base)));
+        digits[--end] = static_cast<char>((digit < 10) ? ('0' + digit) :
+          ((uppercase ? 'A' : 'a') + digit - 10));
+        value /= static_cast<unsigned>(base);
+      } while (value != 0);
+      if (showbase && (arg.bits_ != 0)) {
+        if (base == 16) {
+          prefix = (uppercase ? "0X" : "0x");
+          prefix_size = 2;
+        } else if (base == 8) {
+          digits[--end] = '0';  // Not a prefix for internal padding
+        }
+      }
+      if (base == 10) {
+        if (arg.negative_) {
+          prefix = "-";
+          prefix_size = 1;
+        } else if (showpos && arg.signed_) {
+          prefix = "+";
+          prefix_size = 1;
+        }
+      }
+      body = digits + end;
+      body_size = sizeof(digits) - end;
+    }
+    std::size_t total(prefix_size + body_size);
+    std::size_t padding((width > total) ? (width - total) : 0);
+    if (adjust == kLeft) {
+      Put(prefix, prefix_size);
+      Put(body, body_size);
+      Pad(fill, padding);
+    } else if ((adjust == kInternal) && numeric) {
+      Put(prefix, prefix_size);
+      Pad(fill, padding);
+      Put(body, body_size);
+    } else {
+      Pad(fill, padding);
+      Put(prefix, prefix_size);
+      Put(body, body_size);
+    }
+  }
+};
+
+template<StaticText F, auto... A> consteval std::size_t StaticFormatSize() {
+  const StaticArg args[] = { MakeStaticArg(A)..., StaticArg() };
+  return StaticFormatter(F.data_, F.size(), args, sizeof...(A), NULL).Run();
+}
+
+template<StaticText F, auto... A> consteval auto static_format() {
+  StaticString<StaticFormatSize<F, A...>()> result = {};
+  const StaticArg args[] = { MakeStaticArg(A)..., StaticArg() };
+  StaticFormatter(F.data_, F.size(), args, sizeof...(A), result.data_).Run();
+  return result;
+}
+
+}  // namespace osformat
+
+#endif  // __cplusplus >= 202002L
+
+#endif  // OSFORMAT_STATIC_FORMAT_H_
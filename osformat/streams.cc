@@ -0,0 +1,348 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "osformat/streams.h"
+
+#include <stdint.h>  // uint64_t
+
+#include <cstdio>  // fwrite, fflush, fileno, FILE
+#include <cstdlib>  // atexit
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>  // isatty
+#endif
+
+#include <string>
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <mutex>  // NOLINT(build/c++11)
+#endif
+
+using std::string;
+
+namespace osformat {
+
+const std::size_t Pipeline::kDefaultBufferSize;
+
+class PipelineState {
+ public:
+  string buffer_;
+  std::size_t capacity_;
+  bool at_exit_;
+#if __cplusplus >= 201103L
+  std::atomic<bool> active_;
+  std::mutex mutex_;
+#else
+  bool active_;
+#endif
+
+  PipelineState()
+    : capacity_(0), at_exit_(false), active_(false) {
+  }
+};
+
+// Lock the state for the lifetime of the object (only with C++11)
+class PipelineLock {
+ public:
+#if __cplusplus >= 201103L
+  explicit PipelineLock(PipelineState *state)
+    : lock_(state->mutex_) {
+  }
+
+ private:
+  std::lock_guard<std::mutex> lock_;
+#else
+  explicit PipelineLock(PipelineState *) {
+  }
+#endif
+};
+
+#if __cplusplus >= 201103L
+typedef std::atomic<uint64_t> OrderedCounter;
+#else
+typedef uint64_t OrderedCounter;
+#endif
+
+class OrderedState {
+ public:
+  // The number of the last message
+  OrderedCounter sequence_;
+  // For stdout and stderr, the number of the oldest unflushed message, or 0
+  OrderedCounter dirty_[2];
+  bool at_exit_;
+#if __cplusplus >= 201103L
+  std::atomic<bool> active_;
+#else
+  bool active_;
+#endif
+
+  OrderedState()
+    : sequence_(0), at_exit_(false), active_(false) {
+    dirty_[0] = dirty_[1] = 0;
+  }
+};
+
+// Declarations of some static helper functions:
+
+static PipelineState& State();
+
+static OrderedState& Order();
+
+// The index of file in OrderedState::dirty_ (or -1)
+static int OrderedIndex(FILE *file);
+
+// Flush the stream with the index if it has unflushed messages
+static bool FlushOrdered(OrderedState *state, int index);
+
+static void SyncOrderedAtExit();
+
+static bool Drain(PipelineState *state);
+
+static bool WriteAll(const char *data, std::size_t size);
+
+static void SyncAtExit();
+
+
+// Definitions of some static helper functions:
+
+// A function-local static is independent of static initialization order
+static PipelineState& State() {
+  static PipelineState state;
+  return state;
+}
+
+static OrderedState& Order() {
+  static OrderedState state;
+  return state;
+}
+
+static int OrderedIndex(FILE *file) {
+  if (file == stdout) {
+    return 0;
+  }
+  if (file == stderr) {
+    return 1;
+  }
+  return -1;
+}
+
+static bool FlushOrdered(OrderedState *state, int index) {
+#if __cplusplus >= 201103L
+  if (state->dirty_[index].exchange(0) == 0) {
+    return true;
+  }
+#else
+  if (state->dirty_[index] == 0) {
+    return true;
+  }
+  state->dirty_[index] = 0;
+#endif
+  if (index == 0) {
+    // This includes the buffer of the pipeline mode
+    return Pipeline::Sync();
+  }
+  return (std::fflush(stderr) == 0);
+}
+
+static void SyncOrderedAtExit() {
+  Ordered::Sync();
+}
+
+static bool WriteAll(const char *data, std::size_t size) {
+  return (std::fwrite(data, sizeof(char), size, stdout) == size);
+}
+
+// Write the buffer; the state must be locked
+static bool Drain(PipelineState *state) {
+  bool success(true);
+  if (!state->buffer_.empty()) {
+    success = WriteAll(state->buffer_.data(), state->buffer_.size());
+    state->buffer_.clear();
+  }
+  return ((std::fflush(stdout) == 0) && success);
+}
+
+static void SyncAtExit() {
+  Pipeline::Sync();
+}
+
+bool Pipeline::Enable(std::size_t buffer_size) {
+#ifdef HAVE_UNISTD_H
+  if (isatty(fileno(stdout)) == 0) {
+    Force(buffer_size);
+    return true;
+  }
+#else
+  static_cast<void>(buffer_size);
+#endif
+  return active();
+}
+
+void Pipeline::Force(std::size_t buffer_size) {
+  PipelineState& state = State();
+  PipelineLock lock(&state);
+  // The handler is called before the state is destructed
+  if (!state.at_exit_) {
+    state.at_exit_ = true;
+    std::atexit(SyncAtExit);
+  }
+  std::fflush(stdout);
+  if (state.buffer_.size() > buffer_size) {
+    Drain(&state);
+  }
+  state.capacity_ = buffer_size;
+  state.buffer_.reserve(buffer_size);
+  state.active_ = true;
+}
+
+bool Pipeline::Disable() {
+  PipelineState& state = State();
+  PipelineLock lock(&state);
+  state.active_ = false;
+  return Drain(&state);
+}
+
+bool Pipeline::active() {
+  return State().active_;
+}
+
+std::size_t Pipeline::buffered() {
+  PipelineState& state = State();
+  PipelineLock lock(&state);
+  return state.buffer_.size();
+}
+
+bool Pipeline::Sync() {
+  PipelineState& state = State();
+  PipelineLock lock(&state);
+  return Drain(&state);
+}
+
+bool Pipeline::Buffer(FILE *file, const string& data, bool *success) {
+  if (file != stdout) {
+    return false;
+  }
+  PipelineState& state = State();
+  if (!state.active_) {
+    return false;
+  }
+  PipelineLock lock(&state);
+  if (!state.active_) {
+    return false;
+  }
+  *success = true;
+  if (data.size() > state.capacity_ - state.buffer_.size()) {
+    *success = Drain(&state);
+    if (data.size() >= state.capacity_) {
+      *success = (WriteAll(data.data(), data.size()) && *success);
+      return true;
+    }
+  }
+  state.buffer_.append(data);
+  return true;
+}
+
+void Ordered::Enable() {
+  OrderedState& state = Order();
+  // The handler is called before the state is destructed
+  if (!state.at_exit_) {
+    state.at_exit_ = true;
+    std::atexit(SyncOrderedAtExit);
+  }
+  state.active_ = true;
+}
+
+bool Ordered::Disable() {
+  OrderedState& state = Order();
+  state.active_ = false;
+  return Sync();
+}
+
+bool Ordered::active() {
+  return Order().active_;
+}
+
+bool Ordered::Sync() {
+  OrderedState& state = Order();
+  uint64_t out(state.dirty_[0]), err(state.dirty_[1]);
+  // The stream with the older unflushed message is flushed first
+  int first(((err != 0) && ((out == 0) || (err < out))) ? 1 : 0);
+  bool success(FlushOrdered(&state, first));
+  return (FlushOrdered(&state, 1 - first) && success);
+}
+
+bool Ordered::Begin(FILE *file, bool *success) {
+  int index(OrderedIndex(file));
+  if (index < 0) {
+    return false;
+  }
+  OrderedState& state = Order();
+  if (!state.active_) {
+    return false;
+  }
+  *success = FlushOrdered(&state, 1 - index);
+  return true;
+}
+
+std::size_t Ordered::Write(FILE *file, const string& text, bool flush,
+    Error::Code *error) {
+  *error = Error::kNone;
+  if (text.empty()) {
+    return 0;
+  }
+  bool success(true);
+  // In ordered mode, flushing is left to Ordered
+  bool ordered(Begin(file, &success));
+  if (!success) {
+    // The other stream could not be flushed: Report it but still write
+    *error = Error::kFlushFailed;
+  }
+  std::size_t count(0);
+  if (Pipeline::Buffer(file, text, &success)) {
+    // In pipeline mode, flushing is left to the Pipeline
+    if (success) {
+      count = text.size();
+    } else {
+      *error = Error::kWriteFailed;
+    }
+  } else {
+    count = std::fwrite(text.data(), sizeof(char), text.size(), file);
+    if (count < text.size()) {
+      *error = Error::kWriteFailed;
+    } else if (flush && !ordered && (std::fflush(file) != 0)) {
+      *error = Error::kFlushFailed;
+    }
+  }
+  if (ordered && (count != 0)) {
+    End(file);
+  }
+  return count;
+}
+
+void Ordered::End(FILE *file) {
+  int index(OrderedIndex(file));
+  if (index < 0) {
+    return;
+  }
+  OrderedState& state = Order();
+  uint64_t number(++state.sequence_);
+#if __cplusplus >= 201103L
+  uint64_t unflushed(0);
+  state.dirty_[index].compare_exchange_strong(unflushed, number);
+#else
+  if (state.dirty_[index] == 0) {
+    state.dirty_[index] = number;
+  }
+#endif
+}
+
+}  // namespace osformat
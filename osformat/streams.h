@@ -0,0 +1,112 @@
+// This file is part of the osformat project and distributed under the
+// terms of the GNU General Public License v2.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copyright (c)
+//   Martin Väth <martin@mvath.de>
+
+#ifndef OSFORMAT_STREAMS_H_
+#define OSFORMAT_STREAMS_H_ 1
+
+#include "osformat/osformat.h"
+
+#include <cstdio>  // size_t, FILE
+
+#include <string>
+
+namespace osformat {
+
+// Pipeline mode for stdout: If enabled (and stdout is not a terminal), all
+// output of Format objects to stdout (in particular of Print and Say) is
+// collected in a large buffer which is written only when it is full,
+// on Sync(), or at exit. Requested flushes are collapsed into these writes.
+// Output to stdout which does not come from a Format object bypasses the
+// buffer, so call Sync() before such output.
+
+class Pipeline {
+ public:
+  static const std::size_t kDefaultBufferSize = 1024 * 1024;
+
+  // Enable the pipeline mode unless stdout is a terminal.
+  // Return whether the mode is active.
+  static bool Enable(std::size_t buffer_size);
+
+  static bool Enable() {
+    return Enable(kDefaultBufferSize);
+  }
+
+  // Enable the pipeline mode even if stdout is a terminal
+  static void Force(std::size_t buffer_size);
+
+  // Write the buffer and leave the pipeline mode
+  static bool Disable();
+
+  static bool active();
+
+  // The number of bytes currently buffered
+  static std::size_t buffered();
+
+  // Write and flush the buffer. Return false if writing failed.
+  static bool Sync();
+
+  // Used internally: If the pipeline mode is active and file is stdout,
+  // buffer the data and return true; success tells whether the writes
+  // which were necessary for this succeeded.
+  static bool Buffer(FILE *file, const std::string& data, bool *success);
+
+ private:
+#if __cplusplus >= 201103L
+  Pipeline() = delete;
+#else  // __cplusplus < 201103L
+  Pipeline() {}
+#endif  // __cplusplus
+};
+
+// Ordered mode for stdout and stderr: If enabled, output of Format objects
+// to stdout and stderr (in particular of Print, Say, PrintError, and
+// SayError) is not flushed on request. Instead, the messages of both
+// streams are numbered by one shared counter, and before a message is
+// written to one stream, the other stream is flushed if it has unflushed
+// messages. Thus, if both streams go to the same terminal or file, the
+// order of the messages is kept although flushes happen only where the
+// streams alternate (and on Sync() or at exit). The stdout part of this
+// also applies to the buffer of the pipeline mode.
+
+class Ordered {
+ public:
+  static void Enable();
+
+  // Flush the streams and leave the ordered mode
+  static bool Disable();
+
+  static bool active();
+
+  // Flush the streams with unflushed messages (in the order of their
+  // oldest unflushed message). Return false if flushing failed.
+  static bool Sync();
+
+  // Used internally: Write a message to file, honouring the pipeline and
+  // the ordered mode, and flush it if requested (and not ordered).
+  // Return the number of bytes written; error is set to the last failure.
+  static std::size_t Write(FILE *file, const std::string& text, bool flush,
+    Error::Code *error);
+
+ private:
+  // If the ordered mode is active and file is stdout or stderr, flush the
+  // other stream if necessary and return true; success tells whether this
+  // flush succeeded.
+  static bool Begin(FILE *file, bool *success);
+
+  // Record that a message was written to file
+  static void End(FILE *file);
+
+#if __cplusplus >= 201103L
+  Ordered() = delete;
+#else  // __cplusplus < 201103L
+  Ordered() {}
+#endif  // __cplusplus
+};
+
+}  // namespace osformat
+
+#endif  // OSFORMAT_STREAMS_H_